@@ -1,27 +1,427 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
-#include <queue>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
 #include <sstream>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <set>
+#include <functional>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <cerrno>
+#include <csignal>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define AUCTION_SIMD 1
+#endif
 
 using namespace std;
 using namespace chrono;
 
+// -------------------- Ids --------------------
+// Users and items are referred to by compact handles; the display string
+// ("ID1000") lives only in the IdTable.
+typedef uint32_t Id;
+const Id NO_ID = 0;
+
+class IdTable {
+private:
+    mutable shared_mutex lock;
+    vector<string> names;
+    unordered_map<string, Id> lookup;
+
+    Id append() {
+        Id id = (Id)names.size();
+        names.push_back("ID" + to_string(999 + id));
+        lookup.emplace(names.back(), id);
+        return id;
+    }
+
+public:
+    IdTable() : names(1) {} // handle 0 is NO_ID
+
+    // Allocates the next handle. Names follow allocation order ("ID1000" is
+    // handle 1), so a handle alone is enough to rebuild its name on recovery.
+    Id generate() {
+        unique_lock<shared_mutex> guard(lock);
+        return append();
+    }
+
+    // Makes every handle up to and including `id` valid.
+    void ensure(Id id) {
+        unique_lock<shared_mutex> guard(lock);
+        while (names.size() <= id)
+            append();
+    }
+
+    size_t size() const {
+        shared_lock<shared_mutex> guard(lock);
+        return names.size() - 1;
+    }
+
+    Id find(const string& name) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = lookup.find(name);
+        return it == lookup.end() ? NO_ID : it->second;
+    }
+
+    // Returned by value: names may reallocate under a concurrent generate().
+    string name(Id id) const {
+        shared_lock<shared_mutex> guard(lock);
+        return id < names.size() ? names[id] : names[NO_ID];
+    }
+};
+
+// -------------------- Money --------------------
+// Amounts and balances are whole minor units (cents) in an int64, so sums and
+// comparisons are exact and price columns are plain integers. Doubles only
+// appear at the edges: console input, the gateway's f64 fields and display.
+class Money {
+private:
+    int64_t minor;
+
+public:
+    static const int64_t SCALE = 100;
+
+    constexpr Money() : minor(0) {}
+    constexpr explicit Money(int64_t minorUnits) : minor(minorUnits) {}
+
+    // Largest amount accepted from outside the process; far enough inside
+    // int64 minor units that sums of such amounts cannot overflow.
+    static constexpr double MAX_WIRE_AMOUNT = 1e12;
+
+    static Money fromDouble(double amount) { return Money(llround(amount * SCALE)); }
+    // Whether an untrusted amount is finite, positive and at most
+    // MAX_WIRE_AMOUNT, i.e. safe to pass to fromDouble().
+    static bool validInput(double amount) { return isfinite(amount) && amount > 0 && amount <= MAX_WIRE_AMOUNT; }
+    static constexpr Money units(int64_t whole) { return Money(whole * SCALE); }
+
+    constexpr int64_t minorUnits() const { return minor; }
+    double toDouble() const { return (double)minor / SCALE; }
+
+    constexpr Money operator+(Money other) const { return Money(minor + other.minor); }
+    constexpr Money operator-(Money other) const { return Money(minor - other.minor); }
+    constexpr Money operator-() const { return Money(-minor); }
+    Money& operator+=(Money other) { minor += other.minor; return *this; }
+    Money& operator-=(Money other) { minor -= other.minor; return *this; }
+
+    constexpr bool operator==(Money other) const { return minor == other.minor; }
+    constexpr bool operator!=(Money other) const { return minor != other.minor; }
+    constexpr bool operator<(Money other) const { return minor < other.minor; }
+    constexpr bool operator<=(Money other) const { return minor <= other.minor; }
+    constexpr bool operator>(Money other) const { return minor > other.minor; }
+    constexpr bool operator>=(Money other) const { return minor >= other.minor; }
+};
+
+inline ostream& operator<<(ostream& out, Money amount) {
+    return out << amount.toDouble();
+}
+
+// -------------------- ShardedMap --------------------
+// Hash map split into N independently locked shards. Entries are never erased,
+// so pointers handed out by find()/emplace() stay valid after the shard lock
+// is released; callers synchronise on the value's own lock.
+template <typename K, typename V, size_t N = 64>
+class ShardedMap {
+private:
+    struct Shard {
+        mutable shared_mutex lock;
+        unordered_map<K, V> map;
+    };
+    array<Shard, N> shards;
+
+    Shard& shardFor(const K& key) { return shards[hash<K>()(key) % N]; }
+    const Shard& shardFor(const K& key) const { return shards[hash<K>()(key) % N]; }
+
+public:
+    V* find(const K& key) {
+        Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.map.find(key);
+        return it == shard.map.end() ? nullptr : &it->second;
+    }
+
+    const V* find(const K& key) const {
+        const Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.map.find(key);
+        return it == shard.map.end() ? nullptr : &it->second;
+    }
+
+    // Constructs the value in place; returns {value, inserted}.
+    template <typename... Args>
+    pair<V*, bool> emplace(const K& key, Args&&... args) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        auto slot = shard.map.try_emplace(key, forward<Args>(args)...);
+        return { &slot.first->second, slot.second };
+    }
+
+    // Runs fn on the (default-constructed if missing) value under the shard lock.
+    template <typename F>
+    void update(const K& key, F fn) {
+        Shard& shard = shardFor(key);
+        unique_lock<shared_mutex> guard(shard.lock);
+        fn(shard.map[key]);
+    }
+
+    void reserve(size_t count) {
+        for (auto& shard : shards) {
+            unique_lock<shared_mutex> guard(shard.lock);
+            shard.map.reserve(shard.map.size() + count / N + 1);
+        }
+    }
+
+    // Runs fn on the value for key, if present, under a shared shard lock.
+    template <typename F>
+    bool forKey(const K& key, F fn) const {
+        const Shard& shard = shardFor(key);
+        shared_lock<shared_mutex> guard(shard.lock);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end())
+            return false;
+        fn(it->second);
+        return true;
+    }
+
+    template <typename F>
+    void forEach(F fn) const {
+        for (const auto& shard : shards) {
+            shared_lock<shared_mutex> guard(shard.lock);
+            for (const auto& pair : shard.map)
+                fn(pair.first, pair.second);
+        }
+    }
+};
+
+// -------------------- Sessions --------------------
+// A session handle is (generation << 32) | (slot + 1), so NO_SESSION never
+// names a live session and a handle goes stale when its slot is reused. A slot
+// holds (generation << 32) | userId. find() is two atomic loads and takes no
+// lock; open() and close() only lock one of a few free-list stripes. Handles
+// identify a session, they are not credentials.
+typedef uint64_t SessionId;
+const SessionId NO_SESSION = 0;
+
+class SessionTable {
+private:
+    static const size_t BLOCK = size_t(1) << 12;
+    static const size_t MAX_BLOCKS = size_t(1) << 12;
+    static const size_t STRIPES = 16;
+
+    struct Block {
+        atomic<uint64_t> state[BLOCK];
+    };
+
+    struct Stripe {
+        mutex lock;
+        vector<uint32_t> free;
+    };
+
+    array<atomic<Block*>, MAX_BLOCKS> blocks{};
+    atomic<uint32_t> next{ 0 };
+    mutex growLock;
+    array<Stripe, STRIPES> stripes;
+
+    atomic<uint64_t>* slotState(uint32_t slot) const {
+        if (slot >= next.load(memory_order_acquire))
+            return nullptr;
+        Block* block = blocks[slot / BLOCK].load(memory_order_acquire);
+        return block ? &block->state[slot % BLOCK] : nullptr;
+    }
+
+    Stripe& localStripe() {
+        return stripes[hash<thread::id>()(this_thread::get_id()) % STRIPES];
+    }
+
+    uint32_t allocate() {
+        Stripe& stripe = localStripe();
+        {
+            lock_guard<mutex> guard(stripe.lock);
+            if (!stripe.free.empty()) {
+                uint32_t slot = stripe.free.back();
+                stripe.free.pop_back();
+                return slot;
+            }
+        }
+        lock_guard<mutex> guard(growLock);
+        uint32_t slot = next.load(memory_order_relaxed);
+        if (slot / BLOCK >= MAX_BLOCKS)
+            return UINT32_MAX;
+        if (!blocks[slot / BLOCK].load(memory_order_relaxed))
+            blocks[slot / BLOCK].store(new Block(), memory_order_release);
+        next.store(slot + 1, memory_order_release);
+        return slot;
+    }
+
+public:
+    ~SessionTable() {
+        for (auto& block : blocks)
+            delete block.load();
+    }
+
+    // Returns NO_SESSION if the table is full.
+    SessionId open(Id userId) {
+        uint32_t slot = allocate();
+        atomic<uint64_t>* state = slot == UINT32_MAX ? nullptr : slotState(slot);
+        if (!state)
+            return NO_SESSION;
+        uint64_t generation = (state->load(memory_order_relaxed) >> 32) + 1;
+        state->store(generation << 32 | userId, memory_order_release);
+        return generation << 32 | (slot + 1);
+    }
+
+    // The session's user, or NO_ID for a closed or unknown handle.
+    Id find(SessionId session) const {
+        const atomic<uint64_t>* state = slotState((uint32_t)session - 1);
+        if (!state)
+            return NO_ID;
+        uint64_t current = state->load(memory_order_acquire);
+        return (current >> 32) == (session >> 32) ? (Id)current : NO_ID;
+    }
+
+    bool close(SessionId session) {
+        uint32_t slot = (uint32_t)session - 1;
+        atomic<uint64_t>* state = slotState(slot);
+        if (!state)
+            return false;
+        uint64_t current = state->load(memory_order_acquire);
+        if ((current >> 32) != (session >> 32) || (Id)current == NO_ID ||
+            !state->compare_exchange_strong(current, current & ~uint64_t(UINT32_MAX)))
+            return false;
+        Stripe& stripe = localStripe();
+        lock_guard<mutex> guard(stripe.lock);
+        stripe.free.push_back(slot);
+        return true;
+    }
+};
+
+// -------------------- Clock --------------------
+// steady_clock has no fixed epoch, so persisted times are wall-clock nanoseconds.
+inline nanoseconds steadyToWallOffset() {
+    static const nanoseconds offset =
+        duration_cast<nanoseconds>(system_clock::now().time_since_epoch()) -
+        duration_cast<nanoseconds>(steady_clock::now().time_since_epoch());
+    return offset;
+}
+
+inline int64_t toWallNanos(time_point<steady_clock> t) {
+    return (duration_cast<nanoseconds>(t.time_since_epoch()) + steadyToWallOffset()).count();
+}
+
+inline time_point<steady_clock> fromWallNanos(int64_t ns) {
+    return time_point<steady_clock>(duration_cast<steady_clock::duration>(nanoseconds(ns) - steadyToWallOffset()));
+}
+
+// Coarse engine time. A background thread republishes steady_clock::now()
+// every RESOLUTION, so expiry checks and bid timestamps are one relaxed load
+// instead of a clock read each. freeze()/advance() switch it to manual time
+// for deterministic replay and benchmarks; resume() goes back to real time
+// without ever stepping backwards. Latency measurements still read
+// steady_clock directly.
+class EngineClock {
+private:
+    static constexpr nanoseconds RESOLUTION = microseconds(500);
+
+    atomic<int64_t> ticks;
+    mutex lock; // orders manual changes against the ticker's stores
+    bool manual = false;
+    bool stopping = false;
+    condition_variable wake;
+    thread ticker;
+
+    static int64_t read() {
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    void run() {
+        unique_lock<mutex> guard(lock);
+        while (!wake.wait_for(guard, RESOLUTION, [&] { return stopping; })) {
+            if (!manual)
+                ticks.store(max(read(), ticks.load(memory_order_relaxed)), memory_order_relaxed);
+        }
+    }
+
+public:
+    EngineClock() : ticks(read()), ticker(&EngineClock::run, this) {}
+
+    ~EngineClock() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        ticker.join();
+    }
+
+    time_point<steady_clock> now() const {
+        return time_point<steady_clock>(
+            duration_cast<steady_clock::duration>(nanoseconds(ticks.load(memory_order_relaxed))));
+    }
+
+    void freeze(time_point<steady_clock> at) {
+        lock_guard<mutex> guard(lock);
+        manual = true;
+        ticks.store(duration_cast<nanoseconds>(at.time_since_epoch()).count(), memory_order_relaxed);
+    }
+
+    void advance(nanoseconds step) {
+        ticks.fetch_add(step.count(), memory_order_relaxed);
+    }
+
+    void resume() {
+        lock_guard<mutex> guard(lock);
+        manual = false;
+        ticks.store(max(read(), ticks.load(memory_order_relaxed)), memory_order_relaxed);
+    }
+};
+
+inline EngineClock& engineClock() {
+    static EngineClock clock;
+    return clock;
+}
+
+inline time_point<steady_clock> engineNow() {
+    return engineClock().now();
+}
+
 // -------------------- Bid --------------------
 struct Bid {
-    string userId;
-    double amount;
+    Id userId;
+    Id itemId;
+    Money amount;
     time_point<steady_clock> timestamp;
-    string itemId;
 
-    Bid(const string& uid, double amt, const string& iid)
-        : userId(uid), amount(amt), timestamp(steady_clock::now()), itemId(iid) {}
+    Bid(Id uid, Money amt, Id iid)
+        : userId(uid), itemId(iid), amount(amt), timestamp(engineNow()) {}
 
-    Bid() : userId(""), amount(0.0), itemId(""), timestamp(steady_clock::now()) {}
+    Bid(Id uid, Money amt, Id iid, time_point<steady_clock> ts)
+        : userId(uid), itemId(iid), amount(amt), timestamp(ts) {}
+
+    Bid() : userId(NO_ID), itemId(NO_ID), amount(), timestamp(engineNow()) {}
 
     bool operator<(const Bid& other) const {
         if (amount != other.amount)
@@ -30,418 +430,5528 @@ struct Bid {
     }
 };
 
+enum class BidResult : uint8_t {
+    Accepted,
+    NotLoggedIn,
+    AuctionNotFound,
+    InsufficientBalance,
+    NotActive,
+    BelowStartingPrice,
+    BelowHighestBid,
+    OwnItem,
+    InvalidAmount,
+    AlreadySold, // a format that closes on its first bid already has it
+    BelowAsk     // under a falling auction's current asking price
+};
+
+// -------------------- Events --------------------
+enum class SettleResult : uint8_t {
+    Sold,
+    NoBids,
+    ReserveNotMet,
+    AlreadyEnded,
+    AuctionNotFound
+};
+
+enum class EventType : uint8_t {
+    BidAccepted,
+    BidRejected,
+    AuctionSettled
+};
+
+struct Event {
+    EventType type;
+    BidResult bidResult;       // BidAccepted / BidRejected
+    SettleResult settleResult; // AuctionSettled
+    Id itemId;
+    Id userId;                 // bidder, or winner (NO_ID if unsold)
+    Money amount;             // bid amount, or sale price
+};
+
+// Receives engine events; publish() may be called from any thread.
+class EventSink {
+public:
+    virtual ~EventSink() {}
+    virtual void publish(const Event& event) = 0;
+
+    // A run of events at once, e.g. one auction's share of a bid batch.
+    virtual void publishAll(const Event* events, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            publish(events[i]);
+    }
+};
+
+class NoopSink : public EventSink {
+public:
+    void publish(const Event&) override {}
+};
+
+// Collects events until drained.
+class BufferedSink : public EventSink {
+private:
+    mutex lock;
+    vector<Event> events;
+
+public:
+    void publish(const Event& event) override {
+        lock_guard<mutex> guard(lock);
+        events.push_back(event);
+    }
+
+    void publishAll(const Event* batch, size_t count) override {
+        lock_guard<mutex> guard(lock);
+        events.insert(events.end(), batch, batch + count);
+    }
+
+    vector<Event> drain() {
+        lock_guard<mutex> guard(lock);
+        vector<Event> out;
+        out.swap(events);
+        return out;
+    }
+};
+
+// -------------------- Leaderboard --------------------
+// Top-K distinct bidders kept in a fixed array, best first (ordered by Bid::operator<).
+template <size_t K>
+class Leaderboard {
+private:
+    array<Bid, K> entries;
+    size_t count = 0;
+
+public:
+    void insert(const Bid& bid) {
+        size_t pos = 0;
+        while (pos < count && entries[pos].userId != bid.userId)
+            pos++;
+
+        if (pos < count) {
+            // Drop the bidder's previous entry so each bidder appears once.
+            for (size_t i = pos; i + 1 < count; i++)
+                entries[i] = move(entries[i + 1]);
+            count--;
+        } else if (count == K && !(entries[K - 1] < bid)) {
+            return;
+        }
+
+        if (count < K) count++;
+        pos = count - 1;
+        while (pos > 0 && entries[pos - 1] < bid) {
+            entries[pos] = move(entries[pos - 1]);
+            pos--;
+        }
+        entries[pos] = bid;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    const Bid& top() const { return entries[0]; }
+    const Bid& operator[](size_t i) const { return entries[i]; }
+    const Bid* begin() const { return entries.data(); }
+    const Bid* end() const { return entries.data() + count; }
+};
+
+// -------------------- BidColumns --------------------
+// Read-only column view over a run of bids (archived segment or live window).
+// Timestamps are wall-clock nanoseconds.
+struct BidColumns {
+    const Id* users;
+    const Money* amounts;
+    const int64_t* timestamps;
+    size_t count;
+};
+
 // -------------------- Item --------------------
 struct Item {
-    string id;
+    Id id;
     string name;
     string description;
-    double startingPrice;
-    double reservePrice;
-    string sellerId;
+    Money startingPrice;
+    Money reservePrice;
+    Id sellerId;
     time_point<steady_clock> startTime;
     time_point<steady_clock> endTime;
     bool isActive;
 
-    // Default constructor
-    Item() : id(""), name(""), description(""), startingPrice(0.0), reservePrice(0.0),
-             sellerId(""), isActive(false), startTime(steady_clock::now()), endTime(steady_clock::now()) {}
+    // Default constructor
+    Item() : id(NO_ID), name(""), description(""), startingPrice(), reservePrice(),
+             sellerId(NO_ID), isActive(false), startTime(engineNow()), endTime(engineNow()) {}
+
+    // Parameterized constructor
+    Item(Id itemId, string itemName, string desc,
+         Money startPrice, Money reserve, Id seller, int durationMinutes)
+        : id(itemId), name(move(itemName)), description(move(desc)), startingPrice(startPrice),
+          reservePrice(reserve), sellerId(seller), isActive(true) {
+        startTime = engineNow();
+        endTime = startTime + minutes(durationMinutes);
+    }
+
+    bool isExpired() const {
+        return isExpired(engineNow());
+    }
+
+    bool isExpired(time_point<steady_clock> now) const {
+        return now > endTime;
+    }
+
+    int getRemainingSeconds() const {
+        auto remaining = duration_cast<seconds>(endTime - engineNow());
+        return max(0, (int)remaining.count());
+    }
+};
+
+// -------------------- User --------------------
+enum class Activity : uint8_t { Bid, Owned, Sold };
+
+// Fixed-size ring of a user's most recent item ids plus a lifetime count.
+// A full ring overwrites its oldest entry; AuctionSystem archives the older
+// half first when it has somewhere to put it.
+template <size_t N>
+class ActivityRing {
+private:
+    array<Id, N> ids{};
+    uint32_t head = 0; // next write position
+    uint32_t held = 0;
+    uint64_t total = 0;
+
+public:
+    void push(Id id) {
+        ids[head] = id;
+        head = (head + 1) % N;
+        held = min<uint32_t>(held + 1, N);
+        total++;
+    }
+
+    // Counts an entry without storing it again.
+    void repeat() { total++; }
+
+    bool full() const { return held == N; }
+    size_t size() const { return held; }
+    uint64_t count() const { return total; }
+
+    // The i-th oldest entry held.
+    Id operator[](size_t i) const { return ids[(head + N - held + i) % N]; }
+
+    Id newest() const { return held ? (*this)[held - 1] : NO_ID; }
+
+    void dropOldest(size_t n) { held -= (uint32_t)min<size_t>(n, held); }
+
+    vector<Id> recent() const {
+        vector<Id> out;
+        for (size_t i = 0; i < held; i++)
+            out.push_back((*this)[i]);
+        return out;
+    }
+
+    void restore(uint64_t lifetime, const vector<Id>& recentIds) {
+        head = held = 0;
+        for (size_t i = recentIds.size() > N ? recentIds.size() - N : 0; i < recentIds.size(); i++)
+            push(recentIds[i]);
+        total = lifetime;
+    }
+};
+
+class User {
+public:
+    static const size_t RECENT = 32;
+    typedef ActivityRing<RECENT> Ring;
+
+    Id id;
+    string username;
+    string email;
+    Money balance;
+    Money reserved; // escrowed for the auctions this user currently leads
+    Ring bidHistory;       // consecutive bids on one item are stored once
+    Ring ownedItems;
+    Ring soldItems;
+    mutable mutex lock; // guards balance and the activity rings
+
+    User() : id(NO_ID), username(""), email(""), balance() {}
+
+    User(Id userId, string uname, string mail, Money bal = Money())
+        : id(userId), username(move(uname)), email(move(mail)), balance(bal) {}
+
+    bool canBid(Money amount) const {
+        return balance >= amount;
+    }
+
+    Money available() const {
+        return balance - reserved;
+    }
+
+    // Escrow: hold on bid, release when outbid, capture on win.
+    bool reserve(Money amount) {
+        if (available() < amount)
+            return false;
+        reserved += amount;
+        return true;
+    }
+
+    void release(Money amount) {
+        reserved = max(Money(), reserved - amount);
+    }
+
+    void capture(Money amount) {
+        release(amount);
+        balance -= amount;
+    }
+
+    void deductBalance(Money amount) {
+        if (balance >= amount)
+            balance -= amount;
+    }
+
+    void addBalance(Money amount) {
+        balance += amount;
+    }
+
+    Ring& activity(Activity kind) {
+        return kind == Activity::Bid ? bidHistory : kind == Activity::Owned ? ownedItems : soldItems;
+    }
+
+    const Ring& activity(Activity kind) const {
+        return kind == Activity::Bid ? bidHistory : kind == Activity::Owned ? ownedItems : soldItems;
+    }
+};
+
+// -------------------- SeqLock --------------------
+// A single-writer seqlock over a small trivially copyable value. store() is
+// O(1) and never blocks readers; load() retries until it sees a copy that no
+// store overlapped, so readers on any thread get a consistent snapshot with
+// no lock and no writes to shared memory. Writers must be serialized by the
+// caller. The value is kept as atomic words so the protocol is race-free.
+template <typename T>
+class SeqLocked {
+private:
+    static_assert(is_trivially_copyable<T>::value, "SeqLocked needs a trivially copyable value");
+    static const size_t WORDS = (sizeof(T) + 7) / 8;
+
+    atomic<uint32_t> sequence{ 0 }; // odd while a store is in progress
+    array<atomic<uint64_t>, WORDS> words{};
+
+public:
+    void store(const T& value) {
+        uint64_t raw[WORDS] = {};
+        memcpy(raw, &value, sizeof(T));
+        uint32_t current = sequence.load(memory_order_relaxed);
+        sequence.store(current + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+            words[i].store(raw[i], memory_order_relaxed);
+        sequence.store(current + 2, memory_order_release);
+    }
+
+    T load() const {
+        uint64_t raw[WORDS];
+        uint32_t before;
+        do {
+            before = sequence.load(memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++)
+                raw[i] = words[i].load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+        } while ((before & 1) || sequence.load(memory_order_relaxed) != before);
+        T value;
+        memcpy(&value, raw, sizeof(T));
+        return value;
+    }
+};
+
+// -------------------- Auction policies --------------------
+// Compile-time auction formats. BasicAuction<Policy> and
+// BasicAuctionSystem<Policy> call a policy statically, so each format gets its
+// own inlined bid path with no virtual dispatch. A policy supplies:
+//   check()         the acceptance rule for a bid on an active auction
+//   price()         the price shown while the auction runs, at a given time
+//   reserveMet()    whether the leading bid clears the reserve
+//   clearingPrice() what the winner pays, never more than the winning bid
+//   CLOSES_ON_BID   whether the first accepted bid ends the auction
+//   PROXIES         whether proxy bids are offered
+//   SEALED          whether the leader stays hidden until the close
+//   FALLING         whether price() drops with time, so the shown prices are
+//                   refreshed on every expiry pass
+// The auction lock is held around every call.
+
+// Ascending open auction: each bid must beat the current price; the winner
+// pays its own bid.
+struct EnglishAuction {
+    static constexpr bool CLOSES_ON_BID = false;
+    static constexpr bool PROXIES = true;
+    static constexpr bool SEALED = false;
+    static constexpr bool FALLING = false;
+
+    template <typename A>
+    static BidResult check(const A& auction, Id userId, Money amount, time_point<steady_clock>) {
+        if (amount <= auction.getItem().startingPrice)
+            return BidResult::BelowStartingPrice;
+        if (!auction.getLeaders().empty() && amount <= auction.getLeaders().top().amount)
+            return BidResult::BelowHighestBid;
+        if (userId == auction.getItem().sellerId)
+            return BidResult::OwnItem;
+        return BidResult::Accepted;
+    }
+
+    template <typename A>
+    static Money price(const A& auction, time_point<steady_clock>) {
+        return auction.getLeaders().empty() ? auction.getItem().startingPrice : auction.getLeaders().top().amount;
+    }
+
+    template <typename A>
+    static bool reserveMet(const A& auction) {
+        return price(auction, time_point<steady_clock>()) >= auction.getItem().reservePrice;
+    }
+
+    template <typename A>
+    static Money clearingPrice(const A& auction) {
+        return auction.getLeaders().top().amount;
+    }
+};
+
+// Descending-price auction: the ask falls linearly from the starting price
+// at open to the reserve price at close, and the first bid at or above the
+// ask wins outright at its amount.
+struct DutchAuction {
+    static constexpr bool CLOSES_ON_BID = true;
+    static constexpr bool PROXIES = false;
+    static constexpr bool SEALED = false;
+    static constexpr bool FALLING = true;
+
+    static Money askingPrice(const Item& item, time_point<steady_clock> now) {
+        double span = duration<double>(item.endTime - item.startTime).count();
+        double elapsed = duration<double>(now - item.startTime).count();
+        double progress = span > 0.0 ? min(1.0, max(0.0, elapsed / span)) : 1.0;
+        return item.startingPrice - Money(llround((item.startingPrice - item.reservePrice).minorUnits() * progress));
+    }
+
+    template <typename A>
+    static BidResult check(const A& auction, Id userId, Money amount, time_point<steady_clock> now) {
+        if (!auction.getLeaders().empty())
+            return BidResult::AlreadySold;
+        if (amount <= Money()) // a reserve of 0 lets the ask fall to 0
+            return BidResult::InvalidAmount;
+        if (amount < askingPrice(auction.getItem(), now))
+            return BidResult::BelowAsk;
+        if (userId == auction.getItem().sellerId)
+            return BidResult::OwnItem;
+        return BidResult::Accepted;
+    }
+
+    template <typename A>
+    static Money price(const A& auction, time_point<steady_clock> now) {
+        return auction.getLeaders().empty() ? askingPrice(auction.getItem(), now) : auction.getLeaders().top().amount;
+    }
+
+    // Compared rather than assumed: the ask only stays above the reserve when
+    // the reserve is below the starting price, and nothing enforces that.
+    template <typename A>
+    static bool reserveMet(const A& auction) {
+        return !auction.getLeaders().empty() && auction.getLeaders().top().amount >= auction.getItem().reservePrice;
+    }
+
+    template <typename A>
+    static Money clearingPrice(const A& auction) {
+        return auction.getLeaders().top().amount;
+    }
+};
+
+// Sealed-bid second-price (Vickrey) auction: bids are hidden and need only
+// beat the starting price and the bidder's own previous bid; the highest
+// bidder pays the second-highest bid, or the reserve if that is higher.
+struct VickreyAuction {
+    static constexpr bool CLOSES_ON_BID = false;
+    static constexpr bool PROXIES = false;
+    static constexpr bool SEALED = true;
+    static constexpr bool FALLING = false;
+
+    template <typename A>
+    static BidResult check(const A& auction, Id userId, Money amount, time_point<steady_clock>) {
+        if (amount <= auction.getItem().startingPrice)
+            return BidResult::BelowStartingPrice;
+        auto previous = auction.getUserBids().find(userId);
+        if (previous != auction.getUserBids().end() && amount <= previous->second)
+            return BidResult::BelowHighestBid;
+        if (userId == auction.getItem().sellerId)
+            return BidResult::OwnItem;
+        return BidResult::Accepted;
+    }
+
+    template <typename A>
+    static Money price(const A& auction, time_point<steady_clock>) {
+        return auction.getItem().startingPrice; // sealed until settlement
+    }
+
+    template <typename A>
+    static bool reserveMet(const A& auction) {
+        return auction.getLeaders().top().amount >= auction.getItem().reservePrice;
+    }
+
+    template <typename A>
+    static Money clearingPrice(const A& auction) {
+        const auto& leaders = auction.getLeaders();
+        Money second = leaders.size() > 1 ? leaders[1].amount : auction.getItem().startingPrice;
+        return min(leaders.top().amount, max(second, auction.getItem().reservePrice));
+    }
+};
+
+// -------------------- Auction --------------------
+template <typename Policy>
+class BasicAuction {
+public:
+    // A standing proxy bid: the engine bids for `userId` up to `ceiling`.
+    // Between equal ceilings the earlier one (lower seq) ranks first.
+    struct Proxy {
+        Money ceiling;
+        uint64_t seq;
+        Id userId;
+
+        bool operator<(const Proxy& other) const {
+            return ceiling != other.ceiling ? ceiling > other.ceiling : seq < other.seq;
+        }
+    };
+
+    // What readers see without the lock; republished by every bid and by
+    // the close. `active` is the flag only: readers also check the end time.
+    // A sealed auction shows no leader and no reserve until it closes.
+    struct View {
+        Money price;
+        Id leader;
+        uint32_t bidCount;
+        bool active;
+        bool reserveMet;
+    };
+
+private:
+    static const size_t LEADERBOARD_SIZE = 8;
+    typedef pmr::set<Proxy> ProxyBook;
+
+    Item item;
+    Leaderboard<LEADERBOARD_SIZE> bids;
+
+    // The per-bid containers draw from a per-auction arena: growth never goes
+    // back to the global allocator, and releaseHistory() hands the whole
+    // arena back in one step. Declared first so it outlives the containers.
+    pmr::monotonic_buffer_resource arena{ 1024 };
+    pmr::unordered_map<Id, Money> userHighestBids{ &arena };
+
+    // Recent bids, column-wise. With a BidArchive attached, older bids are
+    // spilled there and only the window stays in memory.
+    pmr::vector<Id> recentUsers{ &arena };
+    pmr::vector<Money> recentAmounts{ &arena };
+    pmr::vector<int64_t> recentTimes{ &arena };
+
+    // Proxies ordered best first, plus each user's entry for O(log n) replacement.
+    // Proxies come and go while the auction runs, so their nodes go through a
+    // pool that recycles them; the arena alone would never reuse a freed node.
+    pmr::unsynchronized_pool_resource proxyPool{ &arena };
+    ProxyBook proxies{ &proxyPool };
+    pmr::unordered_map<Id, typename ProxyBook::iterator> proxyOf{ &proxyPool };
+    uint64_t proxySeq = 0;
+
+    size_t archivedBids = 0;
+    bool released = false;
+    uint32_t tableSlot = 0;
+    SeqLocked<View> view;
+
+    void publish(time_point<steady_clock> now = engineNow()) {
+        bool hidden = isSealed();
+        view.store({ getCurrentPrice(now), hidden ? NO_ID : getHighestBid().userId, (uint32_t)getBidCount(),
+                     item.isActive, !hidden && hasReserveBeenMet() });
+    }
+
+    void index(const Bid& bid) {
+        bids.insert(bid);
+        userHighestBids[bid.userId] = max(userHighestBids[bid.userId], bid.amount);
+    }
+
+    void record(const Bid& bid) {
+        index(bid);
+        recentUsers.push_back(bid.userId);
+        recentAmounts.push_back(bid.amount);
+        recentTimes.push_back(toWallNanos(bid.timestamp));
+        publish();
+    }
+
+public:
+    mutable mutex lock; // held by AuctionSystem around every access
+
+    BasicAuction() { publish(); }
+    BasicAuction(const Item& itm) : item(itm) { publish(); }
+    BasicAuction(Item&& itm) : item(move(itm)) { publish(); }
+
+    bool isActive() const {
+        return item.isActive && !item.isExpired();
+    }
+
+    bool isActive(time_point<steady_clock> now) const {
+        return item.isActive && !item.isExpired(now);
+    }
+
+    void endAuction() {
+        item.isActive = false;
+        proxyOf.clear();
+        proxies.clear();
+        publish();
+    }
+
+    // Applies a bid that was already accepted once (journal or snapshot
+    // recovery), skipping validation and the clock.
+    void restoreBid(const Bid& bid) {
+        record(bid);
+    }
+
+    // Snapshot recovery: archived runs only rebuild the leaderboard and the
+    // per-user maxima; the recent window is restored into memory as well.
+    void restoreArchived(const BidColumns& run) {
+        for (size_t i = 0; i < run.count; i++)
+            index(Bid(run.users[i], run.amounts[i], item.id, fromWallNanos(run.timestamps[i])));
+        archivedBids += run.count;
+        publish();
+    }
+
+    void restoreRecent(const BidColumns& run) {
+        for (size_t i = 0; i < run.count; i++)
+            record(Bid(run.users[i], run.amounts[i], item.id, fromWallNanos(run.timestamps[i])));
+    }
+
+    // Validates and applies a bid without any I/O; `now` is the caller's
+    // cached clock reading, so a batch costs one clock read, not one per bid.
+    BidResult tryBid(Id userId, Money amount, time_point<steady_clock> timestamp, time_point<steady_clock> now) {
+        BidResult result = checkBid(userId, amount, now);
+        if (result == BidResult::Accepted)
+            record(Bid(userId, amount, item.id, timestamp));
+        return result;
+    }
+
+    // tryBid in two steps, so funds can be escrowed between validation and
+    // acceptance without releasing the lock.
+    BidResult checkBid(Id userId, Money amount, time_point<steady_clock> now) const {
+        if (!isActive(now))
+            return Policy::CLOSES_ON_BID && !bids.empty() ? BidResult::AlreadySold : BidResult::NotActive;
+        return Policy::check(*this, userId, amount, now);
+    }
+
+    // Whether an accepted bid of `amount` takes the lead (not so for a
+    // sealed bid below the current top).
+    bool wouldLead(Money amount) const {
+        return bids.empty() || amount > bids.top().amount;
+    }
+
+    void acceptBid(Id userId, Money amount, time_point<steady_clock> timestamp) {
+        record(Bid(userId, amount, item.id, timestamp));
+    }
+
+    // Registers or replaces the user's proxy; O(log n).
+    void setProxy(Id userId, Money ceiling) {
+        dropProxy(userId);
+        proxyOf[userId] = proxies.insert({ ceiling, ++proxySeq, userId }).first;
+    }
+
+    void dropProxy(Id userId) {
+        auto it = proxyOf.find(userId);
+        if (it == proxyOf.end())
+            return;
+        proxies.erase(it->second);
+        proxyOf.erase(it);
+    }
+
+    // The highest and second-highest ceilings, or nullptr.
+    const Proxy* topProxy() const {
+        return proxies.empty() ? nullptr : &*proxies.begin();
+    }
+
+    const Proxy* runnerUpProxy() const {
+        return proxies.size() < 2 ? nullptr : &*next(proxies.begin());
+    }
+
+    // Calls fn(Proxy) for every proxy, best first.
+    template <typename F>
+    void forEachProxy(F fn) const {
+        for (const Proxy& proxy : proxies)
+            fn(proxy);
+    }
+
+    // Reference into the leaderboard; copy it before releasing the lock.
+    const Bid& getHighestBid() const {
+        static const Bid none;
+        return bids.empty() ? none : bids.top();
+    }
+
+    Money getCurrentPrice(time_point<steady_clock> now = engineNow()) const {
+        return Policy::price(*this, now);
+    }
+
+    // Republishes the view if the price has moved since; true if it had.
+    bool reprice(time_point<steady_clock> now) {
+        if (getCurrentPrice(now) == view.load().price)
+            return false;
+        publish(now);
+        return true;
+    }
+
+    // What the leader pays on a sale; only meaningful with a bid.
+    Money getClearingPrice() const {
+        return Policy::clearingPrice(*this);
+    }
+
+    const Item& getItem() const {
+        return item;
+    }
+
+    // Lock-free. The item's other fields never change after construction,
+    // so together with this they make a consistent read without the lock.
+    View getView() const {
+        return view.load();
+    }
+
+    const Leaderboard<LEADERBOARD_SIZE>& getLeaders() const {
+        return bids;
+    }
+
+    BidColumns recentBids() const {
+        return { recentUsers.data(), recentAmounts.data(), recentTimes.data(), recentUsers.size() };
+    }
+
+    // Forgets the oldest `count` window entries once they have been archived.
+    void dropOldest(size_t count) {
+        recentUsers.erase(recentUsers.begin(), recentUsers.begin() + count);
+        recentAmounts.erase(recentAmounts.begin(), recentAmounts.begin() + count);
+        recentTimes.erase(recentTimes.begin(), recentTimes.begin() + count);
+        archivedBids += count;
+    }
+
+    // Frees the arena once the auction is settled and all of its bids are in
+    // the archive. The leaderboard (a fixed array) survives; per-user maxima
+    // must then be recomputed from the archive.
+    void releaseHistory() {
+        pmr::unordered_map<Id, Money>(&arena).swap(userHighestBids);
+        pmr::unordered_map<Id, typename ProxyBook::iterator>(&proxyPool).swap(proxyOf);
+        ProxyBook(&proxyPool).swap(proxies);
+        pmr::vector<Id>(&arena).swap(recentUsers);
+        pmr::vector<Money>(&arena).swap(recentAmounts);
+        pmr::vector<int64_t>(&arena).swap(recentTimes);
+        proxyPool.release();
+        arena.release();
+        released = true;
+    }
+
+    bool isReleased() const {
+        return released;
+    }
+
+    uint32_t getSlot() const {
+        return tableSlot;
+    }
+
+    void setSlot(uint32_t slot) {
+        tableSlot = slot;
+    }
+
+    size_t getBidCount() const {
+        return archivedBids + recentUsers.size();
+    }
+
+    const pmr::unordered_map<Id, Money>& getUserBids() const {
+        return userHighestBids;
+    }
+
+    // Calls fn(userId, highestAmount) for every bidder.
+    template <typename F>
+    void forEachUserBid(F fn) const {
+        for (const auto& pair : userHighestBids)
+            fn(pair.first, pair.second);
+    }
+
+    bool hasReserveBeenMet() const {
+        return Policy::reserveMet(*this);
+    }
+
+    bool isSealed() const {
+        return Policy::SEALED && item.isActive;
+    }
+};
+
+typedef BasicAuction<EnglishAuction> Auction;
+
+// -------------------- ExpiryWheel --------------------
+// Hashed timing wheel with one-second slots. schedule() is O(1); advance() only
+// visits the slots between the previous and the current tick, so nothing ever
+// scans the whole auction table. Deadlines further out than one revolution
+// simply stay in their slot until their tick comes round.
+class ExpiryWheel {
+private:
+    static const size_t SLOTS = 4096;
+
+    struct Entry {
+        Id itemId;
+        int64_t tick;
+    };
+
+    mutex lock;
+    time_point<steady_clock> origin;
+    int64_t currentTick = 0; // last tick already processed
+    array<vector<Entry>, SLOTS> slots;
+
+    // First tick at which endTime has definitely passed.
+    int64_t tickOf(time_point<steady_clock> endTime) const {
+        return duration_cast<seconds>(endTime - origin).count() + 1;
+    }
+
+    void collect(vector<Entry>& slot, int64_t upTo, vector<Id>& due) {
+        size_t kept = 0;
+        for (const auto& entry : slot) {
+            if (entry.tick <= upTo)
+                due.push_back(entry.itemId);
+            else
+                slot[kept++] = entry;
+        }
+        slot.resize(kept);
+    }
+
+public:
+    ExpiryWheel() : origin(engineNow()) {}
+
+    void schedule(Id itemId, time_point<steady_clock> endTime) {
+        lock_guard<mutex> guard(lock);
+        int64_t tick = max(tickOf(endTime), currentTick + 1);
+        slots[tick % SLOTS].push_back({ itemId, tick });
+    }
+
+    // Appends every item whose deadline passed by `now` to `due`.
+    void advance(time_point<steady_clock> now, vector<Id>& due) {
+        lock_guard<mutex> guard(lock);
+        int64_t target = duration_cast<seconds>(now - origin).count();
+        if (target <= currentTick)
+            return;
+
+        if (target - currentTick >= (int64_t)SLOTS) {
+            for (auto& slot : slots)
+                collect(slot, target, due);
+        } else {
+            for (int64_t tick = currentTick + 1; tick <= target; tick++)
+                collect(slots[tick % SLOTS], target, due);
+        }
+        currentTick = target;
+    }
+};
+
+// -------------------- LiveIndex --------------------
+// Live auctions ordered by Key (then Id), sharded so concurrent bids rarely
+// share a lock. page() merges the shards and walks forward from a cursor, so a
+// page costs O(shards * (log n + limit)) however many auctions have existed.
+template <typename Key, typename Compare = less<Key>>
+class LiveIndex {
+public:
+    typedef pair<Key, Id> Cursor;
+
+private:
+    static const size_t SHARDS = 16;
+
+    struct Order {
+        bool operator()(const Cursor& a, const Cursor& b) const {
+            if (Compare()(a.first, b.first)) return true;
+            if (Compare()(b.first, a.first)) return false;
+            return a.second < b.second;
+        }
+    };
+
+    struct Shard {
+        mutable mutex lock;
+        set<Cursor, Order> order;
+        unordered_map<Id, Key> keys;
+    };
+    array<Shard, SHARDS> shards;
+
+public:
+    void upsert(Id id, const Key& key) {
+        Shard& shard = shards[id % SHARDS];
+        lock_guard<mutex> guard(shard.lock);
+        auto slot = shard.keys.try_emplace(id, key);
+        if (!slot.second) {
+            shard.order.erase({ slot.first->second, id });
+            slot.first->second = key;
+        }
+        shard.order.insert({ key, id });
+    }
+
+    void erase(Id id) {
+        Shard& shard = shards[id % SHARDS];
+        lock_guard<mutex> guard(shard.lock);
+        auto it = shard.keys.find(id);
+        if (it == shard.keys.end())
+            return;
+        shard.order.erase({ it->second, id });
+        shard.keys.erase(it);
+    }
+
+    // Up to `limit` entries strictly after `after` (or from the start).
+    vector<Cursor> page(size_t limit, const Cursor* after = nullptr) const {
+        vector<Cursor> merged;
+        for (const auto& shard : shards) {
+            lock_guard<mutex> guard(shard.lock);
+            auto it = after ? shard.order.upper_bound(*after) : shard.order.begin();
+            for (size_t taken = 0; it != shard.order.end() && taken < limit; ++it, ++taken)
+                merged.push_back(*it);
+        }
+
+        size_t count = min(limit, merged.size());
+        partial_sort(merged.begin(), merged.begin() + count, merged.end(), Order());
+        merged.resize(count);
+        return merged;
+    }
+};
+
+// -------------------- Sweep kernels --------------------
+// Filters a run of table slots against one `now`: writes the ids of slots
+// that are active and (expired ? endTicks < now : endTicks >= now) to `out`,
+// which must have room for `count` ids, and returns how many were written.
+// The widest kernel the CPU supports is picked once at startup.
+namespace sweep {
+
+inline size_t scalar(const int64_t* endTicks, const uint8_t* active, const Id* ids, size_t count,
+                     int64_t now, bool expired, Id* out) {
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        out[written] = ids[i];
+        written += (active[i] != 0) & ((endTicks[i] < now) == expired);
+    }
+    return written;
+}
+
+#ifdef AUCTION_SIMD
+// Bit i set when active[i] != 0, for 8 slots.
+__attribute__((target("sse2"))) inline unsigned activeMask8(const uint8_t* active) {
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(active));
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) & 0xFF;
+}
+
+__attribute__((target("avx2"))) inline size_t avx2(const int64_t* endTicks, const uint8_t* active,
+                                                   const Id* ids, size_t count, int64_t now, bool expired,
+                                                   Id* out) {
+    const __m256i nowLanes = _mm256_set1_epi64x(now);
+    const unsigned flip = expired ? 0 : 0xFF;
+    size_t written = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(endTicks + i));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(endTicks + i + 4));
+        unsigned past = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(nowLanes, low))) |
+                        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(nowLanes, high))) << 4;
+        for (unsigned mask = (past ^ flip) & activeMask8(active + i); mask; mask &= mask - 1)
+            out[written++] = ids[i + __builtin_ctz(mask)];
+    }
+    return written + scalar(endTicks + i, active + i, ids + i, count - i, now, expired, out + written);
+}
+
+__attribute__((target("avx512f,avx512vl"))) inline size_t avx512(const int64_t* endTicks, const uint8_t* active,
+                                                                const Id* ids, size_t count, int64_t now,
+                                                                bool expired, Id* out) {
+    const __m512i nowLanes = _mm512_set1_epi64(now);
+    const unsigned flip = expired ? 0 : 0xFF;
+    size_t written = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i ends = _mm512_loadu_si512(endTicks + i);
+        __mmask8 mask = (_mm512_cmplt_epi64_mask(ends, nowLanes) ^ flip) & activeMask8(active + i);
+        __m256i slots = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i));
+        _mm256_mask_compressstoreu_epi32(out + written, mask, slots);
+        written += __builtin_popcount(mask);
+    }
+    return written + scalar(endTicks + i, active + i, ids + i, count - i, now, expired, out + written);
+}
+#endif
+
+typedef size_t (*Kernel)(const int64_t*, const uint8_t*, const Id*, size_t, int64_t, bool, Id*);
+
+inline Kernel select() {
+#ifdef AUCTION_SIMD
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+        return avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return avx2;
+#endif
+    return scalar;
+}
+
+inline size_t run(const int64_t* endTicks, const uint8_t* active, const Id* ids, size_t count, int64_t now,
+                  bool expired, Id* out) {
+    static const Kernel kernel = select();
+    return kernel(endTicks, active, ids, count, now, expired, out);
+}
+
+} // namespace sweep
+
+// -------------------- AuctionTable --------------------
+// Structure-of-arrays mirror of the per-auction hot state: end time, current
+// price and active flag, one slot per auction. Cold metadata (name,
+// description, seller, reserve) stays in Item. Catalogue-wide scans walk
+// these columns sequentially instead of touching every Auction.
+//
+// Columns live in fixed blocks that are never moved, so slots can be written
+// under their auction's lock while scans run without any lock.
+class AuctionTable {
+public:
+    static constexpr size_t BLOCK = size_t(1) << 16;
+    static constexpr size_t MAX_BLOCKS = size_t(1) << 12;
+
+    struct Block {
+        int64_t endTicks[BLOCK]; // steady_clock nanoseconds; written once
+        Id itemId[BLOCK];
+        atomic<Money> price[BLOCK];
+        atomic<uint8_t> active[BLOCK];
+    };
+
+private:
+    array<atomic<Block*>, MAX_BLOCKS> blocks{};
+    atomic<size_t> count{ 0 };
+    mutex growLock;
+
+public:
+    ~AuctionTable() {
+        for (auto& block : blocks)
+            delete block.load();
+    }
+
+    static int64_t ticks(time_point<steady_clock> t) {
+        return duration_cast<nanoseconds>(t.time_since_epoch()).count();
+    }
+
+    uint32_t add(Id itemId, time_point<steady_clock> endTime, Money price, bool active) {
+        lock_guard<mutex> guard(growLock);
+        size_t slot = count.load(memory_order_relaxed);
+        Block* target = blocks[slot / BLOCK].load(memory_order_relaxed);
+        if (!target) {
+            target = new Block();
+            blocks[slot / BLOCK].store(target, memory_order_release);
+        }
+        size_t i = slot % BLOCK;
+        target->endTicks[i] = ticks(endTime);
+        target->itemId[i] = itemId;
+        target->price[i].store(price, memory_order_relaxed);
+        target->active[i].store(active, memory_order_relaxed);
+        count.store(slot + 1, memory_order_release);
+        return (uint32_t)slot;
+    }
+
+    void setPrice(uint32_t slot, Money price) {
+        blocks[slot / BLOCK].load(memory_order_relaxed)->price[slot % BLOCK].store(price, memory_order_relaxed);
+    }
+
+    void deactivate(uint32_t slot) {
+        blocks[slot / BLOCK].load(memory_order_relaxed)->active[slot % BLOCK].store(0, memory_order_relaxed);
+    }
+
+    const Block& blockOf(uint32_t slot) const {
+        return *blocks[slot / BLOCK].load(memory_order_acquire);
+    }
+
+    Id itemAt(uint32_t slot) const { return blockOf(slot).itemId[slot % BLOCK]; }
+    int64_t endAt(uint32_t slot) const { return blockOf(slot).endTicks[slot % BLOCK]; }
+    Money priceAt(uint32_t slot) const { return blockOf(slot).price[slot % BLOCK].load(memory_order_relaxed); }
+    bool activeAt(uint32_t slot) const { return blockOf(slot).active[slot % BLOCK].load(memory_order_relaxed); }
+
+    size_t size() const {
+        return count.load(memory_order_acquire);
+    }
+
+    // Calls fn(block, begin, end) for each populated run of slots.
+    template <typename F>
+    void forEachBlock(F fn) const {
+        size_t total = size();
+        for (size_t base = 0; base < total; base += BLOCK)
+            fn(*blocks[base / BLOCK].load(memory_order_acquire), 0, min(BLOCK, total - base));
+    }
+
+    // Active auctions whose end time is after / not after `now`. The active
+    // column is copied out a chunk at a time with relaxed loads and the sweep
+    // kernels read the copy, so no atomic is ever read as plain memory; a
+    // slot flipped concurrently may be reported either way, as with any
+    // unlocked scan.
+    void collect(time_point<steady_clock> now, bool expired, vector<Id>& out) const {
+        static constexpr size_t CHUNK = 4096;
+        int64_t nowTicks = ticks(now);
+        forEachBlock([&](const Block& block, size_t begin, size_t end) {
+            uint8_t active[CHUNK];
+            size_t base = out.size();
+            out.resize(base + (end - begin));
+            size_t found = 0;
+            for (size_t from = begin; from < end; from += CHUNK) {
+                size_t n = min(CHUNK, end - from);
+                for (size_t i = 0; i < n; i++)
+                    active[i] = block.active[from + i].load(memory_order_relaxed);
+                found += sweep::run(block.endTicks + from, active, block.itemId + from, n, nowTicks, expired,
+                                    out.data() + base + found);
+            }
+            out.resize(base + found);
+        });
+    }
+};
+
+// -------------------- SearchIndex --------------------
+// Inverted index from the lower-cased words of an item's name and description
+// to the AuctionTable slots of live auctions carrying them. Slots instead of
+// ids let ranking read the current price and end time straight from the
+// table's columns. Settled auctions are pruned lazily: each term counts its
+// dead postings and compacts once they are half the list, so removal is
+// amortised O(1) per term.
+//
+// A query is whitespace-separated words, all of which must match; "word*"
+// matches every term with that prefix, up to MAX_EXPANSION terms in
+// lexicographic order; a broader prefix is cut off there and the search
+// reports itself truncated. Work is bounded by the shortest posting list
+// involved, never by the number of auctions.
+enum class SearchRank : uint8_t { Price, EndingSoonest };
+
+class SearchIndex {
+private:
+    static const size_t MAX_EXPANSION = 256; // terms one prefix may expand to
+
+    struct Postings {
+        vector<uint32_t> slots; // ascending
+        uint32_t dead = 0;
+        bool listed = false; // already in `terms`
+    };
+
+    const AuctionTable& table;
+    ShardedMap<string, Postings> postings;
+    mutable shared_mutex termsLock;
+    set<string> terms; // every term ever indexed, for prefix expansion
+
+    // Distinct lower-cased alphanumeric words of `text`.
+    static vector<string> tokenize(const string& text) {
+        vector<string> words;
+        string word;
+        for (size_t i = 0; i <= text.size(); i++) {
+            unsigned char c = i < text.size() ? (unsigned char)text[i] : ' ';
+            if (isalnum(c)) {
+                word += (char)tolower(c);
+            } else if (!word.empty()) {
+                words.push_back(move(word));
+                word.clear();
+            }
+        }
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        return words;
+    }
+
+    static vector<string> termsOf(const Item& item) {
+        return tokenize(item.name + " " + item.description);
+    }
+
+    // The terms a query word stands for; sets `truncated` if a prefix
+    // matches more than MAX_EXPANSION of them.
+    vector<string> expand(const string& word, bool& truncated) const {
+        if (word.back() != '*')
+            return { word };
+        string prefix = word.substr(0, word.size() - 1);
+        vector<string> matches;
+        shared_lock<shared_mutex> guard(termsLock);
+        auto it = terms.lower_bound(prefix);
+        for (; it != terms.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+            if (matches.size() == MAX_EXPANSION) {
+                truncated = true;
+                break;
+            }
+            matches.push_back(*it);
+        }
+        return matches;
+    }
+
+    // Appends a ∩ b (both ascending) to out. Gallops through b with binary
+    // searches when a is much the shorter, otherwise merges linearly.
+    static void intersect(const vector<uint32_t>& a, const vector<uint32_t>& b, vector<uint32_t>& out) {
+        if (a.size() * 16 < b.size()) {
+            auto from = b.begin();
+            for (uint32_t slot : a) {
+                from = lower_bound(from, b.end(), slot);
+                if (from == b.end())
+                    return;
+                if (*from == slot)
+                    out.push_back(slot);
+            }
+        } else {
+            set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(out));
+        }
+    }
+
+    size_t postingCount(const vector<string>& group) const {
+        size_t total = 0;
+        for (const string& term : group)
+            postings.forKey(term, [&](const Postings& list) { total += list.slots.size(); });
+        return total;
+    }
+
+public:
+    explicit SearchIndex(const AuctionTable& auctionTable) : table(auctionTable) {}
+
+    void add(const Item& item, uint32_t slot) {
+        for (const string& term : termsOf(item)) {
+            bool fresh = false;
+            postings.update(term, [&](Postings& list) {
+                // Slots are handed out in order, so this is almost always an append.
+                list.slots.insert(upper_bound(list.slots.begin(), list.slots.end(), slot), slot);
+                fresh = !list.listed;
+                list.listed = true;
+            });
+            if (fresh) {
+                unique_lock<shared_mutex> guard(termsLock);
+                terms.insert(term);
+            }
+        }
+    }
+
+    // Call after the slot was deactivated in the table.
+    void remove(const Item& item) {
+        for (const string& term : termsOf(item)) {
+            postings.update(term, [&](Postings& list) {
+                if (++list.dead * 2 < list.slots.size())
+                    return;
+                list.slots.erase(remove_if(list.slots.begin(), list.slots.end(),
+                                           [&](uint32_t slot) { return !table.activeAt(slot); }),
+                                 list.slots.end());
+                list.slots.shrink_to_fit();
+                list.dead = 0;
+            });
+        }
+    }
+
+    // Item ids of up to `limit` live auctions matching `query`: highest price
+    // first, or least time left first. `truncated`, if given, is set when a
+    // prefix was cut off at MAX_EXPANSION terms, so matches may be missing.
+    vector<Id> search(const string& query, SearchRank rank, size_t limit, time_point<steady_clock> now,
+                      bool* truncated = nullptr) const {
+        bool cut = false;
+        if (truncated)
+            *truncated = false;
+        vector<vector<string>> groups;
+        istringstream words(query);
+        string word;
+        while (words >> word) {
+            bool prefix = word.back() == '*';
+            vector<string> parts = tokenize(word);
+            if (parts.size() != 1)
+                return {}; // punctuation inside a word can never match a term
+            groups.push_back(expand(parts[0] + (prefix ? "*" : ""), cut));
+            if (truncated)
+                *truncated = cut;
+            if (groups.back().empty())
+                return {};
+        }
+        if (groups.empty() || limit == 0)
+            return {};
+
+        // Seed from the group with the fewest postings; filter by the others.
+        vector<size_t> sizes;
+        for (const auto& group : groups)
+            sizes.push_back(postingCount(group));
+        size_t seed = min_element(sizes.begin(), sizes.end()) - sizes.begin();
+
+        vector<uint32_t> candidates;
+        for (const string& term : groups[seed])
+            postings.forKey(term, [&](const Postings& list) {
+                candidates.insert(candidates.end(), list.slots.begin(), list.slots.end());
+            });
+        if (groups[seed].size() > 1) {
+            sort(candidates.begin(), candidates.end());
+            candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+
+        for (size_t g = 0; g < groups.size() && !candidates.empty(); g++) {
+            if (g == seed)
+                continue;
+            vector<uint32_t> matched;
+            for (const string& term : groups[g])
+                postings.forKey(term, [&](const Postings& list) { intersect(candidates, list.slots, matched); });
+            if (groups[g].size() > 1) {
+                sort(matched.begin(), matched.end());
+                matched.erase(unique(matched.begin(), matched.end()), matched.end());
+            }
+            candidates.swap(matched);
+        }
+
+        int64_t nowTicks = AuctionTable::ticks(now);
+        candidates.erase(remove_if(candidates.begin(), candidates.end(),
+                                   [&](uint32_t slot) { return !table.activeAt(slot) || table.endAt(slot) <= nowTicks; }),
+                         candidates.end());
+
+        vector<pair<int64_t, uint32_t>> ranked;
+        ranked.reserve(candidates.size());
+        for (uint32_t slot : candidates)
+            ranked.push_back({ rank == SearchRank::Price ? -table.priceAt(slot).minorUnits() : (int64_t)table.endAt(slot), slot });
+        size_t count = min(limit, ranked.size());
+        partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+        vector<Id> results;
+        for (size_t i = 0; i < count; i++)
+            results.push_back(table.itemAt(ranked[i].second));
+        return results;
+    }
+};
+
+// -------------------- SpscQueue --------------------
+// Bounded single-producer/single-consumer ring. Head and tail sit on separate
+// cache lines; each side only writes its own index.
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+private:
+    array<T, N> slots;
+    alignas(64) atomic<size_t> head{ 0 }; // next slot to pop
+    alignas(64) atomic<size_t> tail{ 0 }; // next slot to push
+
+public:
+    bool push(const T& value) {
+        size_t at = tail.load(memory_order_relaxed);
+        if (at - head.load(memory_order_acquire) == N)
+            return false;
+        slots[at % N] = value;
+        tail.store(at + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t at = head.load(memory_order_relaxed);
+        if (at == tail.load(memory_order_acquire))
+            return false;
+        value = slots[at % N];
+        head.store(at + 1, memory_order_release);
+        return true;
+    }
+};
+
+// -------------------- PriceFeed --------------------
+// Price pub/sub. publish() runs on the bid path and is O(1) whatever the
+// number of subscribers: it stores the item's latest price and, unless the
+// item is already waiting, queues it once for the dispatcher thread. The
+// dispatcher copies the latest price into each watcher's slot and queues the
+// slot on that subscriber's ring. A slot is on the ring at most once, so a
+// slow subscriber coalesces to the newest price instead of falling behind.
+struct PriceUpdate {
+    Id itemId;
+    Money price;
+};
+
+class PriceSubscription {
+    friend class PriceFeed;
+
+private:
+    struct Watch {
+        Id itemId;
+        atomic<Money> price{ Money() };
+        atomic<bool> queued{ false };
+        atomic<bool> watching{ true };
+    };
+
+    SpscQueue<Watch*, 1024> ring;          // dispatcher -> subscriber
+    vector<unique_ptr<Watch>> watches;      // guarded by the feed lock
+    bool closed = false;                    // unsubscribed; guarded by the feed lock
+    int wakeFd;
+
+public:
+    PriceSubscription() : wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+    ~PriceSubscription() {
+        if (wakeFd >= 0)
+            ::close(wakeFd);
+    }
+
+    // Readable whenever updates were delivered; next() drains it.
+    int fd() const { return wakeFd; }
+
+    // Latest price of the next changed item; false when nothing is pending.
+    bool next(PriceUpdate& update) {
+        Watch* watch;
+        while (ring.pop(watch)) {
+            watch->queued.store(false, memory_order_release);
+            if (!watch->watching.load(memory_order_acquire))
+                continue;
+            update = { watch->itemId, watch->price.load(memory_order_acquire) };
+            return true;
+        }
+        uint64_t ignored;
+        if (::read(wakeFd, &ignored, sizeof(ignored)) < 0) {} // reset; more may arrive after
+        return false;
+    }
+};
+
+class PriceFeed {
+private:
+    static const size_t STRIPES = 16;
+
+    struct Watcher {
+        shared_ptr<PriceSubscription> subscription;
+        PriceSubscription::Watch* watch;
+    };
+
+    struct Channel {
+        atomic<Money> price{ Money() };
+        atomic<bool> dirty{ false };
+        atomic<uint32_t> watcherCount{ 0 };
+        vector<Watcher> watchers; // guarded by the feed lock
+    };
+
+    struct Stripe {
+        mutex lock;
+        vector<Id> items;
+    };
+
+    ShardedMap<Id, Channel> channels;
+    array<Stripe, STRIPES> pending;
+    mutex lock; // subscriptions and delivery
+    condition_variable wake;
+    atomic<bool> signalled{ false };
+    bool stopping = false;
+    thread dispatcher;
+    vector<Watcher> retry; // ring was full; dispatcher only
+
+    void queue(Id itemId) {
+        Stripe& stripe = pending[itemId % STRIPES];
+        {
+            lock_guard<mutex> guard(stripe.lock);
+            stripe.items.push_back(itemId);
+        }
+        // Not under the feed lock, which the dispatcher holds while delivering;
+        // a wakeup lost to that race only costs the dispatcher's 5 ms poll.
+        if (!signalled.exchange(true))
+            wake.notify_one();
+    }
+
+    static bool deliver(const Watcher& watcher, Money price) {
+        watcher.watch->price.store(price, memory_order_release);
+        if (watcher.watch->queued.exchange(true, memory_order_acq_rel))
+            return true;
+        if (watcher.subscription->ring.push(watcher.watch))
+            return true;
+        watcher.watch->queued.store(false, memory_order_release);
+        return false;
+    }
+
+    void dispatchLoop() {
+        vector<Id> items;
+        vector<PriceSubscription*> woken;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait_for(guard, milliseconds(retry.empty() ? 5 : 1),
+                          [&] { return stopping || signalled.load(); });
+            if (stopping)
+                return;
+            signalled.store(false);
+
+            items.clear();
+            for (Stripe& stripe : pending) {
+                lock_guard<mutex> stripeGuard(stripe.lock);
+                items.insert(items.end(), stripe.items.begin(), stripe.items.end());
+                stripe.items.clear();
+            }
+
+            woken.clear();
+            vector<Watcher> failed;
+            for (const Watcher& watcher : retry) {
+                if (!watcher.watch->watching.load())
+                    continue;
+                if (deliver(watcher, watcher.watch->price.load()))
+                    woken.push_back(watcher.subscription.get());
+                else
+                    failed.push_back(watcher);
+            }
+            for (Id itemId : items) {
+                Channel* channel = channels.find(itemId);
+                if (!channel)
+                    continue;
+                // Clear before reading, so a publish racing with us is queued again.
+                channel->dirty.store(false, memory_order_seq_cst);
+                Money price = channel->price.load(memory_order_seq_cst);
+                for (const Watcher& watcher : channel->watchers) {
+                    if (deliver(watcher, price))
+                        woken.push_back(watcher.subscription.get());
+                    else
+                        failed.push_back(watcher);
+                }
+            }
+            retry.swap(failed);
+
+            sort(woken.begin(), woken.end());
+            woken.erase(unique(woken.begin(), woken.end()), woken.end());
+            uint64_t one = 1;
+            for (PriceSubscription* subscription : woken)
+                if (::write(subscription->wakeFd, &one, sizeof(one)) < 0) {} // counter saturation is harmless
+        }
+    }
+
+public:
+    ~PriceFeed() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            wake.notify_one();
+        }
+        if (dispatcher.joinable())
+            dispatcher.join();
+    }
+
+    // Called with the item's auction lock held.
+    void publish(Id itemId, Money price) {
+        Channel* channel = channels.find(itemId);
+        if (!channel || channel->watcherCount.load(memory_order_relaxed) == 0)
+            return;
+        channel->price.store(price, memory_order_seq_cst);
+        if (!channel->dirty.exchange(true, memory_order_seq_cst))
+            queue(itemId);
+    }
+
+    shared_ptr<PriceSubscription> subscribe() {
+        lock_guard<mutex> guard(lock);
+        if (!dispatcher.joinable())
+            dispatcher = thread(&PriceFeed::dispatchLoop, this);
+        return make_shared<PriceSubscription>();
+    }
+
+    // Starts delivering the item's price, beginning with `current`.
+    void watch(const shared_ptr<PriceSubscription>& subscription, Id itemId, Money current) {
+        Channel* channel = channels.emplace(itemId).first;
+        {
+            lock_guard<mutex> guard(lock);
+            if (subscription->closed)
+                return;
+            subscription->watches.emplace_back(new PriceSubscription::Watch());
+            PriceSubscription::Watch* watch = subscription->watches.back().get();
+            watch->itemId = itemId;
+            channel->watchers.push_back({ subscription, watch });
+            if (channel->watcherCount.fetch_add(1) == 0)
+                channel->price.store(current);
+        }
+        if (!channel->dirty.exchange(true))
+            queue(itemId);
+    }
+
+    // Stops every watch of the subscription; pending updates are dropped.
+    // Later calls, and later watch() calls, do nothing. The Watch objects
+    // stay with the subscription: its ring may still point at them.
+    void unsubscribe(const shared_ptr<PriceSubscription>& subscription) {
+        lock_guard<mutex> guard(lock);
+        if (subscription->closed)
+            return;
+        subscription->closed = true;
+        for (auto& watch : subscription->watches) {
+            watch->watching.store(false);
+            Channel& channel = *channels.find(watch->itemId);
+            auto& list = channel.watchers;
+            list.erase(remove_if(list.begin(), list.end(),
+                                 [&](const Watcher& watcher) { return watcher.watch == watch.get(); }),
+                       list.end());
+            channel.watcherCount.fetch_sub(1);
+        }
+        retry.erase(remove_if(retry.begin(), retry.end(),
+                              [&](const Watcher& watcher) { return watcher.subscription == subscription; }),
+                    retry.end());
+    }
+};
+
+// -------------------- Persistence --------------------
+// Little helpers for the fixed-layout binary journal and snapshot formats.
+class BinaryWriter {
+public:
+    vector<char> buffer;
+
+    template <typename T>
+    void put(const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putString(const string& value) {
+        put((uint32_t)value.size());
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    template <typename T>
+    void putVector(const vector<T>& values) {
+        put((uint32_t)values.size());
+        const char* bytes = reinterpret_cast<const char*>(values.data());
+        buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+};
+
+class BinaryReader {
+private:
+    const char* pos;
+    const char* end;
+    bool failed = false;
+
+public:
+    BinaryReader(const char* data, size_t size) : pos(data), end(data + size) {}
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return pos == end; }
+    size_t remaining() const { return end - pos; }
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (failed || remaining() < sizeof(T)) {
+            failed = true;
+            return value;
+        }
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string getString() {
+        uint32_t size = get<uint32_t>();
+        if (failed || remaining() < size) {
+            failed = true;
+            return "";
+        }
+        string value(pos, size);
+        pos += size;
+        return value;
+    }
+
+    template <typename T>
+    vector<T> getVector() {
+        uint32_t count = get<uint32_t>();
+        if (failed || remaining() / sizeof(T) < count) {
+            failed = true;
+            return {};
+        }
+        vector<T> values(count);
+        if (count == 0) // data() may be null, and memcpy must not see it
+            return values;
+        memcpy(values.data(), pos, count * sizeof(T));
+        pos += count * sizeof(T);
+        return values;
+    }
+};
+
+inline uint32_t checksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    return hash;
+}
+
+inline bool readFile(const string& path, vector<char>& out) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        out.insert(out.end(), chunk, chunk + got);
+    fclose(file);
+    return true;
+}
+
+enum class RecordType : uint8_t {
+    Register = 1,
+    CreateAuction,
+    Bid,
+    Settle,
+    Balance,
+    Proxy,
+    Batch // the Bid and Proxy records of one placeBids() call, unframed
+};
+
+// Append-only write-ahead log with group commit. append() only copies the
+// record into a pending buffer; a background thread writes and fdatasync()s
+// whatever accumulated while the previous flush was in progress, so one
+// fsync covers many records. sync() waits until everything appended so far
+// is durable.
+//
+// A failed write or fdatasync latches the log as failed: nothing more is
+// written (a partial record would tear everything after it), and append()
+// and sync() return false from then on. A checkpoint starts a healthy log
+// by rotating this same object onto a new file, so callers never see the
+// Journal itself replaced.
+//
+// File layout: "AUCWAL02", uint64 generation, then records of
+// [uint32 size][uint32 checksum][payload].
+class Journal {
+private:
+    int fd = -1;
+    mutex lock;
+    condition_variable wake;
+    condition_variable flushed;
+    vector<char> pending;
+    uint64_t appendedBytes = 0;
+    uint64_t durableBytes = 0;
+    bool stopping = false;
+    bool failed = false;
+    uint64_t rotations = 0; // bumped whenever the file is swapped out
+    thread flusher;
+
+    void flushLoop() {
+        vector<char> writing;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping)
+                return;
+            if (failed) {
+                pending.clear();
+                continue;
+            }
+
+            writing.swap(pending);
+            uint64_t target = appendedBytes;
+            guard.unlock();
+
+            bool ok = true;
+            for (size_t written = 0; ok && written < writing.size();) {
+                ssize_t n = ::write(fd, writing.data() + written, writing.size() - written);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                ok = n > 0;
+                written += ok ? n : 0;
+            }
+            ok = ok && fdatasync(fd) == 0;
+            writing.clear();
+
+            guard.lock();
+            if (ok)
+                durableBytes = target;
+            else
+                failed = true;
+            flushed.notify_all();
+        }
+    }
+
+public:
+    static const char* magic() { return "AUCWAL02"; }
+
+    ~Journal() {
+        close();
+    }
+
+    static constexpr uint64_t HEADER_BYTES = 16;
+
+    // Writes a durable header for `generation` to a new file at `path` and
+    // returns its descriptor, or -1.
+    static int createFile(const string& path, uint64_t generation) {
+        int created = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (created < 0)
+            return -1;
+        BinaryWriter header;
+        header.buffer.assign(magic(), magic() + 8);
+        header.put(generation);
+        if (::write(created, header.buffer.data(), header.buffer.size()) != (ssize_t)header.buffer.size() ||
+            fdatasync(created) != 0) {
+            ::close(created);
+            return -1;
+        }
+        return created;
+    }
+
+    // Starts a fresh log for `generation`, replacing any file at `path`.
+    bool create(const string& path, uint64_t generation) {
+        fd = createFile(path, generation);
+        if (fd < 0)
+            return false;
+        return start(HEADER_BYTES);
+    }
+
+    // Drains the current file, closes it and continues on `next` (from
+    // createFile()) as a healthy log. Waiters in sync() on the old file are
+    // released as successful: rotation only follows a snapshot covering it.
+    void rotate(int next) {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            wake.notify_one();
+        }
+        if (flusher.joinable())
+            flusher.join();
+        lock_guard<mutex> guard(lock);
+        ::close(fd);
+        fd = next;
+        rotations++;
+        appendedBytes = durableBytes = HEADER_BYTES;
+        stopping = false;
+        failed = false;
+        flusher = thread(&Journal::flushLoop, this);
+        flushed.notify_all();
+    }
+
+    // Continues an existing log whose valid prefix is `validBytes` long.
+    bool reopen(const string& path, uint64_t validBytes) {
+        fd = ::open(path.c_str(), O_WRONLY);
+        if (fd < 0)
+            return false;
+        if (ftruncate(fd, validBytes) != 0 || lseek(fd, 0, SEEK_END) < 0)
+            return abandon();
+        return start(validBytes);
+    }
+
+    bool start(uint64_t existingBytes) {
+        appendedBytes = durableBytes = existingBytes;
+        stopping = false;
+        failed = false;
+        flusher = thread(&Journal::flushLoop, this);
+        return true;
+    }
+
+    // Closes a log that failed before its flusher started.
+    bool abandon() {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    // False once the log has failed (or is closed); the record is dropped.
+    bool append(const BinaryWriter& record) {
+        uint32_t size = (uint32_t)record.buffer.size();
+        uint32_t sum = checksum(record.buffer.data(), size);
+        lock_guard<mutex> guard(lock);
+        if (failed || fd < 0)
+            return false;
+        const char* header[] = { reinterpret_cast<const char*>(&size), reinterpret_cast<const char*>(&sum) };
+        pending.insert(pending.end(), header[0], header[0] + 4);
+        pending.insert(pending.end(), header[1], header[1] + 4);
+        pending.insert(pending.end(), record.buffer.begin(), record.buffer.end());
+        appendedBytes += 8 + size;
+        wake.notify_one();
+        return true;
+    }
+
+    // Waits for everything appended so far; false once the log has failed,
+    // since a record may have been dropped.
+    bool sync() {
+        unique_lock<mutex> guard(lock);
+        uint64_t target = appendedBytes;
+        uint64_t seen = rotations;
+        flushed.wait(guard, [&] { return durableBytes >= target || failed || fd < 0 || rotations != seen; });
+        return rotations != seen || (!failed && durableBytes >= target);
+    }
+
+    bool healthy() {
+        lock_guard<mutex> guard(lock);
+        return fd >= 0 && !failed;
+    }
+
+    // Latches the log as failed, as a failed write would.
+    void fail() {
+        lock_guard<mutex> guard(lock);
+        failed = true;
+        flushed.notify_all();
+    }
+
+    uint64_t size() {
+        lock_guard<mutex> guard(lock);
+        return appendedBytes;
+    }
+
+    void close() {
+        if (fd < 0)
+            return;
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            wake.notify_one();
+        }
+        if (flusher.joinable())
+            flusher.join();
+        lock_guard<mutex> guard(lock);
+        ::close(fd);
+        fd = -1;
+        flushed.notify_all();
+    }
+};
+
+// Growable file mapping at a fixed address. A large PROT_NONE region is
+// reserved up front and the file is mapped into it in 16 MiB steps, so the
+// base address never moves and pointers into it never see a remap.
+class MappedFile {
+private:
+    static constexpr size_t RESERVE = size_t(1) << 36; // 64 GiB of address space
+    static constexpr size_t GROWTH = size_t(1) << 24;
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0; // mapped (and file) size
+
+public:
+    ~MappedFile() {
+        if (base)
+            munmap(base, RESERVE);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    char* data() const { return base; }
+
+    // Opens or creates `path`; fails if it is shorter than `validBytes`.
+    bool open(const string& path, uint64_t validBytes) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+        void* reserved = mmap(nullptr, RESERVE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reserved == MAP_FAILED)
+            return false;
+        base = static_cast<char*>(reserved);
+
+        struct stat info;
+        return fstat(fd, &info) == 0 && (uint64_t)info.st_size >= validBytes && reserve(max<size_t>(GROWTH, validBytes));
+    }
+
+    // Makes the first `needed` bytes addressable.
+    bool reserve(size_t needed) {
+        if (needed <= capacity)
+            return true;
+        size_t target = capacity;
+        while (target < needed)
+            target = max(target * 2, target + GROWTH);
+        if (target > RESERVE || ftruncate(fd, target) != 0)
+            return false;
+        void* mapped = mmap(base + capacity, target - capacity, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_FIXED, fd, capacity);
+        if (mapped == MAP_FAILED)
+            return false;
+        capacity = target;
+        return true;
+    }
+
+    void sync(size_t bytes) {
+        if (bytes)
+            msync(base, bytes, MS_SYNC);
+    }
+};
+
+// Columnar, memory-mapped store for the bid history of closed auctions and
+// for the overflow of long-running live ones. The file is a sequence of
+// segments, each holding one run of bids for one item:
+//
+//   [uint32 itemId][uint32 count][users: count x uint32, padded to 8]
+//   [amounts: count x int64 cents][timestamps: count x int64]
+//
+// Views handed to visit() callbacks point straight into the mapping.
+class BidArchive {
+private:
+    MappedFile file;
+    size_t used = 0; // bytes of valid segments
+    mutable shared_mutex lock;
+    unordered_map<Id, vector<uint64_t>> segments; // item -> segment offsets
+
+    static size_t padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+    static size_t segmentSize(size_t count) {
+        return 8 + padded(count * sizeof(Id)) + count * (sizeof(Money) + sizeof(int64_t));
+    }
+
+    BidColumns columnsAt(uint64_t offset) const {
+        const char* segment = file.data() + offset;
+        uint32_t count;
+        memcpy(&count, segment + 4, 4);
+        const char* users = segment + 8;
+        const char* amounts = users + padded(count * sizeof(Id));
+        const char* timestamps = amounts + count * sizeof(Money);
+        return { reinterpret_cast<const Id*>(users), reinterpret_cast<const Money*>(amounts),
+                 reinterpret_cast<const int64_t*>(timestamps), count };
+    }
+
+public:
+    bool isOpen() const { return file.isOpen(); }
+
+    // Opens `path`, keeping only its first `validBytes` (what the snapshot
+    // covers; anything later is rebuilt by journal replay).
+    bool open(const string& path, uint64_t validBytes) {
+        if (!file.open(path, validBytes))
+            return false;
+        const char* base = file.data();
+        for (used = 0; used < validBytes;) {
+            Id itemId;
+            uint32_t count;
+            memcpy(&itemId, base + used, 4);
+            memcpy(&count, base + used + 4, 4);
+            segments[itemId].push_back(used);
+            used += segmentSize(count);
+        }
+        return used == validBytes;
+    }
+
+    // Archives the first `count` bids; false if the file could not grow, in
+    // which case nothing was written.
+    bool append(Id itemId, const BidColumns& bids, size_t count) {
+        if (count == 0)
+            return true;
+        unique_lock<shared_mutex> guard(lock);
+        size_t size = segmentSize(count);
+        if (!file.reserve(used + size))
+            return false;
+
+        char* segment = file.data() + used;
+        uint32_t count32 = (uint32_t)count;
+        memcpy(segment, &itemId, 4);
+        memcpy(segment + 4, &count32, 4);
+        char* users = segment + 8;
+        char* amounts = users + padded(count * sizeof(Id));
+        char* timestamps = amounts + count * sizeof(Money);
+        memcpy(users, bids.users, count * sizeof(Id));
+        memcpy(amounts, bids.amounts, count * sizeof(Money));
+        memcpy(timestamps, bids.timestamps, count * sizeof(int64_t));
+
+        segments[itemId].push_back(used);
+        used += size;
+        return true;
+    }
+
+    // Calls fn(BidColumns) for each archived run of the item, oldest first.
+    // The views are only valid inside the callback.
+    template <typename F>
+    void visit(Id itemId, F fn) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = segments.find(itemId);
+        if (it == segments.end())
+            return;
+        for (uint64_t offset : it->second)
+            fn(columnsAt(offset));
+    }
+
+    uint64_t size() const {
+        shared_lock<shared_mutex> guard(lock);
+        return used;
+    }
+
+    void sync() {
+        shared_lock<shared_mutex> guard(lock);
+        file.sync(used);
+    }
+};
+
+// The same layout for the user activity that has aged out of a User's
+// rings, one segment per spilled run:
+//
+//   [uint32 userId][uint32 Activity][uint32 count][ids: count x uint32, padded to 8]
+class ActivityArchive {
+private:
+    MappedFile file;
+    size_t used = 0;
+    mutable shared_mutex lock;
+    unordered_map<uint64_t, vector<uint64_t>> segments; // (userId, kind) -> segment offsets
+
+    static size_t segmentSize(size_t count) { return (12 + count * sizeof(Id) + 7) & ~size_t(7); }
+    static uint64_t keyOf(Id userId, uint32_t kind) { return (uint64_t)userId << 8 | kind; }
+
+public:
+    bool isOpen() const { return file.isOpen(); }
+
+    bool open(const string& path, uint64_t validBytes) {
+        if (!file.open(path, validBytes))
+            return false;
+        const char* base = file.data();
+        for (used = 0; used < validBytes;) {
+            uint32_t header[3];
+            memcpy(header, base + used, 12);
+            segments[keyOf(header[0], header[1])].push_back(used);
+            used += segmentSize(header[2]);
+        }
+        return used == validBytes;
+    }
+
+    // Archives `count` ids; false if the file could not grow, in which case
+    // nothing was written.
+    bool append(Id userId, uint32_t kind, const Id* ids, size_t count) {
+        if (count == 0)
+            return true;
+        unique_lock<shared_mutex> guard(lock);
+        size_t size = segmentSize(count);
+        if (!file.reserve(used + size))
+            return false;
+        char* segment = file.data() + used;
+        uint32_t header[3] = { userId, kind, (uint32_t)count };
+        memcpy(segment, header, 12);
+        memcpy(segment + 12, ids, count * sizeof(Id));
+        segments[keyOf(userId, kind)].push_back(used);
+        used += size;
+        return true;
+    }
+
+    // Calls fn(ids, count) for each archived run, newest run first.
+    template <typename F>
+    void visit(Id userId, uint32_t kind, F fn) const {
+        shared_lock<shared_mutex> guard(lock);
+        auto it = segments.find(keyOf(userId, kind));
+        if (it == segments.end())
+            return;
+        for (auto offset = it->second.rbegin(); offset != it->second.rend(); ++offset) {
+            const char* segment = file.data() + *offset;
+            uint32_t count;
+            memcpy(&count, segment + 8, 4);
+            if (!fn(reinterpret_cast<const Id*>(segment + 12), (size_t)count))
+                return;
+        }
+    }
+
+    uint64_t size() const {
+        shared_lock<shared_mutex> guard(lock);
+        return used;
+    }
+
+    void sync() {
+        shared_lock<shared_mutex> guard(lock);
+        file.sync(used);
+    }
+};
+
+// -------------------- LatencyHistogram --------------------
+// Log-linear histogram of nanosecond latencies: exact below 64 ns, then 32
+// sub-buckets per power of two (about 3% relative error). Not thread-safe;
+// keep one per thread and merge().
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const size_t SUB = size_t(1) << SUB_BITS;
+    static const size_t BUCKETS = 64 * SUB;
+
+private:
+    array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t maxValue = 0;
+
+public:
+    static size_t bucketOf(uint64_t value) {
+        if (value < 2 * SUB)
+            return value;
+        int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return (shift + 1) * SUB + ((value >> shift) - SUB);
+    }
+
+    static uint64_t lowerBound(size_t bucket) {
+        if (bucket < 2 * SUB)
+            return bucket;
+        int shift = (int)(bucket / SUB) - 1;
+        return (bucket % SUB + SUB) << shift;
+    }
+
+    void record(uint64_t nanos) {
+        counts[bucketOf(nanos)]++;
+        total++;
+        sum += nanos;
+        maxValue = max(maxValue, nanos);
+    }
+
+    // Rebuilds a histogram from per-bucket counts and their total, as kept by
+    // Metrics; maximum() is then only known to bucket precision.
+    void add(size_t bucket, uint64_t count) {
+        if (!count)
+            return;
+        counts[bucket] += count;
+        total += count;
+        maxValue = max(maxValue, lowerBound(bucket + 1) - 1);
+    }
+
+    void addSum(uint64_t nanos) { sum += nanos; }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        maxValue = max(maxValue, other.maxValue);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t maximum() const { return maxValue; }
+    double mean() const { return total ? (double)sum / total : 0.0; }
+
+    // Upper bound of the bucket holding the q-quantile, q in [0, 1].
+    uint64_t percentile(double q) const {
+        uint64_t rank = (uint64_t)(q * total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen > rank)
+                return min(maxValue, lowerBound(i + 1) - 1);
+        }
+        return maxValue;
+    }
+};
+
+// -------------------- Metrics --------------------
+// Engine instrumentation. Each thread records into its own slot, so recording
+// is a relaxed load and store on counters no other thread writes: no locks
+// and no locked instructions. snapshot() sums the slots. Threads beyond
+// MAX_THREADS share slots and may occasionally lose an increment.
+enum class TimedOp : uint8_t { PlaceBid, PlaceBids, PlaceProxyBid, CreateAuction, EndAuction, SettleExpired, Login };
+
+const size_t OP_COUNT = 7;
+const size_t BID_RESULT_COUNT = 11;
+const size_t SETTLE_RESULT_COUNT = 5;
+
+struct StatsSnapshot {
+    array<LatencyHistogram, OP_COUNT> latency;
+    array<uint64_t, BID_RESULT_COUNT> bids{};       // indexed by BidResult
+    array<uint64_t, SETTLE_RESULT_COUNT> settles{}; // indexed by SettleResult
+};
+
+class Metrics {
+private:
+    static const size_t MAX_THREADS = 256;
+
+    struct Slot {
+        array<array<atomic<uint64_t>, LatencyHistogram::BUCKETS>, OP_COUNT> buckets;
+        array<atomic<uint64_t>, OP_COUNT> nanos;
+        array<atomic<uint64_t>, BID_RESULT_COUNT> bids;
+        array<atomic<uint64_t>, SETTLE_RESULT_COUNT> settles;
+    };
+
+    array<atomic<Slot*>, MAX_THREADS> slots{};
+
+    static size_t threadIndex() {
+        static atomic<size_t> next{ 0 };
+        thread_local size_t index = next.fetch_add(1) % MAX_THREADS;
+        return index;
+    }
+
+    static void bump(atomic<uint64_t>& counter, uint64_t by = 1) {
+        counter.store(counter.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+    Slot& local() {
+        atomic<Slot*>& entry = slots[threadIndex()];
+        Slot* slot = entry.load(memory_order_acquire);
+        if (!slot) {
+            Slot* created = new Slot(); // value-initialised: all counters zero
+            if (entry.compare_exchange_strong(slot, created, memory_order_acq_rel))
+                slot = created;
+            else
+                delete created;
+        }
+        return *slot;
+    }
+
+public:
+    ~Metrics() {
+        for (auto& slot : slots)
+            delete slot.load();
+    }
+
+    void record(TimedOp op, uint64_t nanos) {
+        Slot& slot = local();
+        bump(slot.buckets[(size_t)op][LatencyHistogram::bucketOf(nanos)]);
+        bump(slot.nanos[(size_t)op], nanos);
+    }
+
+    void count(BidResult result) {
+        bump(local().bids[(size_t)result]);
+    }
+
+    void count(SettleResult result) {
+        bump(local().settles[(size_t)result]);
+    }
+
+    StatsSnapshot snapshot() const {
+        StatsSnapshot out;
+        for (const auto& entry : slots) {
+            const Slot* slot = entry.load(memory_order_acquire);
+            if (!slot)
+                continue;
+            for (size_t op = 0; op < OP_COUNT; op++) {
+                for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++)
+                    out.latency[op].add(b, slot->buckets[op][b].load(memory_order_relaxed));
+                out.latency[op].addSum(slot->nanos[op].load(memory_order_relaxed));
+            }
+            for (size_t r = 0; r < BID_RESULT_COUNT; r++)
+                out.bids[r] += slot->bids[r].load(memory_order_relaxed);
+            for (size_t r = 0; r < SETTLE_RESULT_COUNT; r++)
+                out.settles[r] += slot->settles[r].load(memory_order_relaxed);
+        }
+        return out;
+    }
+};
+
+// Records the enclosing scope's duration.
+class OpTimer {
+private:
+    Metrics& metrics;
+    TimedOp op;
+    time_point<steady_clock> start;
+
+public:
+    OpTimer(Metrics& target, TimedOp timed) : metrics(target), op(timed), start(steady_clock::now()) {}
+
+    ~OpTimer() {
+        metrics.record(op, duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    }
+};
+
+// Prometheus text exposition format, version 0.0.4.
+inline const char* timedOpName(TimedOp op) {
+    static const char* names[OP_COUNT] = { "place_bid", "place_bids", "place_proxy_bid", "create_auction",
+                                           "end_auction", "settle_expired", "login" };
+    return names[(size_t)op];
+}
+
+inline string prometheusText(const StatsSnapshot& stats) {
+    static const char* bids[BID_RESULT_COUNT] = { "accepted", "not_logged_in", "auction_not_found",
+                                                  "insufficient_balance", "not_active", "below_starting_price",
+                                                  "below_highest_bid", "own_item", "invalid_amount",
+                                                  "already_sold", "below_ask" };
+    static const char* settles[SETTLE_RESULT_COUNT] = { "sold", "no_bids", "reserve_not_met", "already_ended",
+                                                        "auction_not_found" };
+    ostringstream out;
+    out << "# HELP auction_op_latency_seconds Engine call latency.\n"
+        << "# TYPE auction_op_latency_seconds summary\n";
+    for (size_t op = 0; op < OP_COUNT; op++) {
+        const LatencyHistogram& latency = stats.latency[op];
+        for (double q : { 0.5, 0.9, 0.99, 0.999 })
+            out << "auction_op_latency_seconds{op=\"" << timedOpName((TimedOp)op) << "\",quantile=\"" << q << "\"} "
+                << latency.percentile(q) / 1e9 << "\n";
+        out << "auction_op_latency_seconds_sum{op=\"" << timedOpName((TimedOp)op) << "\"} "
+            << latency.mean() * latency.count() / 1e9 << "\n";
+        out << "auction_op_latency_seconds_count{op=\"" << timedOpName((TimedOp)op) << "\"} " << latency.count()
+            << "\n";
+    }
+    out << "# HELP auction_bids_total Bids by result.\n# TYPE auction_bids_total counter\n";
+    for (size_t r = 0; r < BID_RESULT_COUNT; r++)
+        out << "auction_bids_total{result=\"" << bids[r] << "\"} " << stats.bids[r] << "\n";
+    out << "# HELP auction_settlements_total Settlements by result.\n# TYPE auction_settlements_total counter\n";
+    for (size_t r = 0; r < SETTLE_RESULT_COUNT; r++)
+        out << "auction_settlements_total{result=\"" << settles[r] << "\"} " << stats.settles[r] << "\n";
+    return out.str();
+}
+
+// -------------------- Recording --------------------
+// Capture of the operation stream entering an AuctionSystem, for replaying
+// it against another build (see "Replay"). Each entry point appends its
+// inputs when called, stamped with the engine time. Between threads, records
+// are in the order they reached the recorder, and replay applies them
+// serially in that order. Calls that assign an id are captured under the
+// same lock as the assignment and carry the id, so creations are recorded
+// in id order and replay can check it hands out the same ids. Recording
+// should start from an empty system.
+//
+// File layout: "AUCREC02", then records of [uint32 size][payload], where a
+// payload is [int64 nanoseconds since recording began][CapturedOp][fields].
+enum class CapturedOp : uint8_t {
+    Register = 1,   // username, email, balance, id assigned (NO_ID if taken)
+    Login,          // username, session returned
+    Logout,         // session
+    CreateAuction,  // seller, name, description, starting price, reserve, minutes, id assigned
+    Bid,            // user, item, amount
+    ProxyBid,       // user, item, ceiling
+    Bids,           // count, then item, user, amount, timestamp per request
+    AddBalance,     // user, amount
+    EndAuction,     // item
+    ExpireAuctions, // now
+    SettleExpired   // now
+};
+
+class OpRecorder {
+private:
+    static const size_t FLUSH_BYTES = size_t(1) << 20;
+
+    FILE* file = nullptr;
+    mutex lock;
+    vector<char> pending;
+    time_point<steady_clock> origin;
+
+    void flush() {
+        if (!pending.empty())
+            fwrite(pending.data(), 1, pending.size(), file);
+        pending.clear();
+    }
+
+public:
+    static const char* magic() { return "AUCREC02"; }
+
+    ~OpRecorder() {
+        close();
+    }
+
+    bool open(const string& path) {
+        file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        origin = engineNow();
+        return fwrite(magic(), 1, 8, file) == 8;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        if (!file)
+            return;
+        flush();
+        fclose(file);
+        file = nullptr;
+    }
+
+    int64_t offset(time_point<steady_clock> t) const {
+        return duration_cast<nanoseconds>(t - origin).count();
+    }
+
+    // A new record stamped with the current engine time.
+    BinaryWriter begin(CapturedOp op) const {
+        BinaryWriter record;
+        record.put(offset(engineNow()));
+        record.put(op);
+        return record;
+    }
+
+    void append(const BinaryWriter& record) {
+        uint32_t size = (uint32_t)record.buffer.size();
+        const char* header = reinterpret_cast<const char*>(&size);
+        lock_guard<mutex> guard(lock);
+        if (!file)
+            return;
+        pending.insert(pending.end(), header, header + 4);
+        pending.insert(pending.end(), record.buffer.begin(), record.buffer.end());
+        if (pending.size() >= FLUSH_BYTES)
+            flush();
+    }
+};
+
+// -------------------- Auction System --------------------
+struct UserRegistration {
+    string username;
+    string email;
+    Money initialBalance = Money::units(1000);
+};
+
+struct BidRequest {
+    Id itemId;
+    Id userId;
+    Money amount;
+    time_point<steady_clock> timestamp;
+};
+
+struct AuctionSummary {
+    Id itemId;
+    Money price;
+    uint32_t bidCount;
+    bool active;
+    int remainingSeconds;
+    Id leader;
+    bool reserveMet;
+};
+
+// One auction format per system: the policy is fixed at compile time (see
+// "Auction policies"). AuctionSystem is the English-auction system.
+template <typename Policy>
+class BasicAuctionSystem {
+private:
+    typedef BasicAuction<Policy> Auction;
+
+    // Every map is sharded and every User/Auction carries its own lock, so calls
+    // touching different auctions run in parallel. Locks only nest as one
+    // Auction lock, then one User lock (escrow()); nothing takes an Auction lock
+    // while holding a User lock, which rules out lock-order deadlocks.
+    IdTable ids;
+    ShardedMap<Id, User> users;
+    ShardedMap<string, Id> usernameIndex; // username -> userId
+    ShardedMap<Id, Auction> auctions;
+    ShardedMap<Id, vector<Id>> userAuctions;
+    ExpiryWheel expiry;
+    LiveIndex<time_point<steady_clock>> endingIndex;
+    LiveIndex<Money, greater<Money>> priceIndex;
+    AuctionTable table;
+    SearchIndex searchIndex{ table };
+    PriceFeed prices;
+    Metrics metrics;
+    NoopSink noopSink;
+    EventSink* sink = &noopSink;
+    OpRecorder* recorder = nullptr;
+
+    // Set once by open(), before other threads start; the Journal lives as
+    // long as the system and checkpoint() only rotates its file. Mutations
+    // hold checkpointLock shared while they apply and journal, so
+    // checkpoint() can take it exclusively and snapshot a state that matches
+    // the log exactly.
+    bool journaled = false;
+    Journal journal;
+    BidArchive archive;
+    ActivityArchive activityArchive;
+    static const size_t HISTORY_WINDOW = 64;
+    string dataDirectory;
+    uint64_t generation = 0;
+    shared_mutex checkpointLock;
+    SessionTable sessions;
+
+    mutex captureOrder; // held while recording, from id assignment to capture
+
+    Id generateId() {
+        return ids.generate();
+    }
+
+    // Inserts into both users and usernameIndex; returns the new id, or NO_ID if taken.
+    Id addUser(const string& username, const string& email, Money initialBalance) {
+        auto scope = mutationScope();
+        unique_lock<mutex> ordered = recorder ? unique_lock<mutex>(captureOrder) : unique_lock<mutex>();
+        auto slot = usernameIndex.emplace(username, NO_ID);
+        if (!slot.second) {
+            capture(CapturedOp::Register, username, email, initialBalance, NO_ID);
+            return NO_ID;
+        }
+
+        Id userId = generateId();
+        capture(CapturedOp::Register, username, email, initialBalance, userId);
+        ordered = unique_lock<mutex>();
+        logRegister(userId, username, email, initialBalance);
+        users.emplace(userId, userId, username, email, initialBalance);
+        usernameIndex.update(username, [&](Id& id) { id = userId; });
+        return userId;
+    }
+
+    // -------- live views --------
+    // The expiry wheel, both LiveIndexes, the AuctionTable and the search
+    // index are updated together through these, with the auction's lock held.
+    void list(Auction& auction) {
+        const Item& item = auction.getItem();
+        auction.setSlot(table.add(item.id, item.endTime, auction.getCurrentPrice(), item.isActive));
+        if (item.isActive) {
+            expiry.schedule(item.id, item.endTime);
+            endingIndex.upsert(item.id, item.endTime);
+            priceIndex.upsert(item.id, auction.getCurrentPrice());
+            searchIndex.add(item, auction.getSlot());
+        }
+    }
+
+    void priceChanged(Auction& auction, time_point<steady_clock> now = engineNow()) {
+        Money price = auction.getCurrentPrice(now);
+        priceIndex.upsert(auction.getItem().id, price);
+        table.setPrice(auction.getSlot(), price);
+        prices.publish(auction.getItem().id, price);
+    }
+
+    // Falling formats: moves every running auction's shown price to `now`.
+    // Costs a pass over the table, so only those formats pay it.
+    void repriceLive(time_point<steady_clock> now) {
+        if (!Policy::FALLING)
+            return;
+        vector<Id> live;
+        table.collect(now, false, live);
+        for (Id itemId : live) {
+            Auction& auction = *auctions.find(itemId);
+            lock_guard<mutex> guard(auction.lock);
+            if (auction.getItem().isActive && auction.reprice(now))
+                priceChanged(auction, now);
+        }
+    }
+
+    void delist(Auction& auction) {
+        endingIndex.erase(auction.getItem().id);
+        priceIndex.erase(auction.getItem().id);
+        table.deactivate(auction.getSlot());
+        searchIndex.remove(auction.getItem());
+    }
+
+    // Builds a summary from the auction's published view; needs no lock.
+    static void summarize(const Auction& auction, time_point<steady_clock> now, AuctionSummary& out) {
+        typename Auction::View view = auction.getView();
+        const Item& item = auction.getItem();
+        int remaining = (int)duration_cast<seconds>(item.endTime - now).count();
+        out = { item.id, view.price, view.bidCount, view.active && !item.isExpired(now), max(0, remaining),
+                view.leader, view.reserveMet };
+    }
+
+    // -------- escrow --------
+    // What placeBids() threads through escrow and the proxy engine. Each
+    // bidder's funds are reserved once up front; its slack is the part no bid
+    // has drawn yet, and holds it loses within the batch flow back into it,
+    // so neither takes the user's lock. The journal entries collect in one
+    // record.
+    struct BidBatch {
+        struct Bidder {
+            User* user = nullptr;
+            Money balance;  // as read when its funds were reserved
+            Money exposure; // sum over items of its highest bid there
+            Money slack;
+            Id lastItem = NO_ID;
+            Money itemHigh;
+            uint32_t firstPlaced = UINT32_MAX; // its accepted bids, in `placed`
+            uint32_t lastPlaced = UINT32_MAX;
+        };
+        struct Placed {
+            Id itemId;
+            uint32_t next; // the bidder's next accepted bid
+        };
+
+        unordered_map<Id, Bidder> bidders;
+        vector<Placed> placed;
+        BinaryWriter record;
+
+        Money* slackOf(Id userId) {
+            auto it = bidders.find(userId);
+            return it == bidders.end() || !it->second.user ? nullptr : &it->second.slack;
+        }
+
+        void place(Bidder& bidder, Id itemId) {
+            uint32_t at = (uint32_t)placed.size();
+            placed.push_back({ itemId, UINT32_MAX });
+            (bidder.lastPlaced == UINT32_MAX ? bidder.firstPlaced : placed[bidder.lastPlaced].next) = at;
+            bidder.lastPlaced = at;
+        }
+    };
+
+    // Makes `user` the holder of the auction's escrow for `amount`: reserves
+    // what the user does not already hold here, then releases the previous
+    // leader's hold. Call with the auction lock held, after checkBid passed.
+    // Each user is only tracked by its `reserved` total, so admission is O(1).
+    // A bid that does not take the lead (sealed formats) holds nothing, but
+    // must still be covered by the balance. Within a batch, slack is drawn
+    // first and only a shortfall is reserved under the lock.
+    bool escrow(const Auction& auction, User& user, Money amount, BidBatch* batch = nullptr) {
+        if (!auction.wouldLead(amount)) {
+            lock_guard<mutex> guard(user.lock);
+            return user.canBid(amount);
+        }
+        Bid leader = auction.getHighestBid();
+        Money needed = amount - (leader.userId == user.id ? leader.amount : Money());
+        Money* slack = batch ? batch->slackOf(user.id) : nullptr;
+        Money drawn = slack ? min(*slack, needed) : Money();
+        if (drawn < needed) {
+            lock_guard<mutex> guard(user.lock);
+            if (!user.reserve(needed - drawn))
+                return false;
+        }
+        if (slack)
+            *slack -= drawn;
+        if (leader.userId != NO_ID && leader.userId != user.id) {
+            if (Money* outbidSlack = batch ? batch->slackOf(leader.userId) : nullptr) {
+                *outbidSlack += leader.amount;
+            } else {
+                User& outbid = *users.find(leader.userId);
+                lock_guard<mutex> guard(outbid.lock);
+                outbid.release(leader.amount);
+            }
+        }
+        return true;
+    }
+
+    // Recovery does not journal holds; they follow from the live leaders.
+    void rebuildEscrow() {
+        vector<Id> userIds;
+        users.forEach([&](Id userId, const User&) { userIds.push_back(userId); });
+        for (Id userId : userIds)
+            users.find(userId)->reserved = Money();
+        auctions.forEach([&](Id, const Auction& auction) {
+            const Bid& leader = auction.getHighestBid();
+            if (auction.getItem().isActive && leader.userId != NO_ID)
+                users.find(leader.userId)->reserved += leader.amount;
+        });
+    }
+
+    // -------- proxy bidding --------
+    static constexpr Money BID_INCREMENT = Money::units(1);
+
+    // Places one engine-generated bid for a proxy, escrowed like any other;
+    // false if it is not valid or cannot be funded. Auction lock held.
+    bool placeForProxy(Auction& auction, Id userId, Money amount, time_point<steady_clock> timestamp,
+                       time_point<steady_clock> now, vector<Bid>& placed, BidBatch* batch) {
+        User& user = *users.find(userId);
+        if (auction.checkBid(userId, amount, now) != BidResult::Accepted || !escrow(auction, user, amount, batch))
+            return false;
+        Id itemId = auction.getItem().id;
+        auction.acceptBid(userId, amount, timestamp);
+        logBid(itemId, userId, amount, timestamp, batch);
+        {
+            lock_guard<mutex> guard(user.lock);
+            recordActivity(user, Activity::Bid, itemId);
+        }
+        placed.push_back(Bid(userId, amount, itemId, timestamp));
+        return true;
+    }
+
+    void withdrawProxy(Auction& auction, Id userId, BidBatch* batch) {
+        logProxy(auction.getItem().id, userId, Money(), batch);
+        auction.dropProxy(userId);
+    }
+
+    // Lets the standing proxies answer the current leader; call with the
+    // auction lock held after any change to the bids or proxies. Only the top
+    // two ceilings matter: the runner-up is bid to its ceiling, and the top
+    // proxy one increment above its strongest rival, capped at its own
+    // ceiling. So one call places at most two bids, whatever the number of
+    // proxies. Proxies that are outbid or cannot be funded are withdrawn.
+    void resolveProxies(Auction& auction, time_point<steady_clock> timestamp, time_point<steady_clock> now,
+                        vector<Bid>& placed, BidBatch* batch = nullptr) {
+        if (!Policy::PROXIES)
+            return;
+        while (const typename Auction::Proxy* top = auction.topProxy()) {
+            Id topUser = top->userId;
+            Money ceiling = top->ceiling;
+            if (ceiling <= auction.getCurrentPrice() && auction.getHighestBid().userId != topUser) {
+                withdrawProxy(auction, topUser, batch);
+                continue;
+            }
+
+            Money rival;
+            if (const typename Auction::Proxy* runnerUp = auction.runnerUpProxy()) {
+                Id runnerUser = runnerUp->userId;
+                rival = runnerUp->ceiling;
+                if (rival < ceiling && rival > auction.getCurrentPrice() &&
+                    !placeForProxy(auction, runnerUser, rival, timestamp, now, placed, batch)) {
+                    withdrawProxy(auction, runnerUser, batch);
+                    continue;
+                }
+            }
+
+            const Bid& leader = auction.getHighestBid();
+            if (leader.userId != topUser)
+                rival = max(rival, leader.amount);
+            Money amount = min(ceiling, max(rival, auction.getItem().startingPrice) + BID_INCREMENT);
+            if (leader.userId == topUser && leader.amount >= amount)
+                return;
+            if (placeForProxy(auction, topUser, amount, timestamp, now, placed, batch))
+                return;
+            withdrawProxy(auction, topUser, batch);
+        }
+    }
+
+    void publishProxyBids(const vector<Bid>& placed) {
+        for (const Bid& bid : placed)
+            publishBid(bid.itemId, bid.userId, bid.amount, BidResult::Accepted);
+    }
+
+    // -------- recording --------
+    void captureField(BinaryWriter& out, const string& value) const { out.putString(value); }
+    void captureField(BinaryWriter& out, time_point<steady_clock> t) const { out.put(recorder->offset(t)); }
+
+    void captureField(BinaryWriter& out, const vector<BidRequest>& requests) const {
+        out.put((uint32_t)requests.size());
+        for (const BidRequest& req : requests) {
+            out.put(req.itemId);
+            out.put(req.userId);
+            out.put(req.amount);
+            captureField(out, req.timestamp);
+        }
+    }
+
+    template <typename T>
+    void captureField(BinaryWriter& out, const T& value) const { out.put(value); }
+
+    // Appends one entry-point call to the recording, if there is one.
+    template <typename... Fields>
+    void capture(CapturedOp op, const Fields&... fields) {
+        if (!recorder)
+            return;
+        BinaryWriter record = recorder->begin(op);
+        (captureField(record, fields), ...);
+        recorder->append(record);
+    }
+
+    // -------- journaling --------
+    shared_lock<shared_mutex> mutationScope() {
+        return journaled ? shared_lock<shared_mutex>(checkpointLock) : shared_lock<shared_mutex>();
+    }
+
+    void logRegister(Id userId, const string& username, const string& email, Money balance) {
+        if (!journaled)
+            return;
+        BinaryWriter record;
+        record.put(RecordType::Register);
+        record.put(userId);
+        record.putString(username);
+        record.putString(email);
+        record.put(balance);
+        journal.append(record);
+    }
+
+    void writeItem(BinaryWriter& out, const Item& item) const {
+        out.put(item.id);
+        out.put(item.sellerId);
+        out.putString(item.name);
+        out.putString(item.description);
+        out.put(item.startingPrice);
+        out.put(item.reservePrice);
+        out.put(toWallNanos(item.startTime));
+        out.put(toWallNanos(item.endTime));
+        out.put((uint8_t)item.isActive);
+    }
+
+    Item readItem(BinaryReader& in) const {
+        Item item;
+        item.id = in.get<Id>();
+        item.sellerId = in.get<Id>();
+        item.name = in.getString();
+        item.description = in.getString();
+        item.startingPrice = in.get<Money>();
+        item.reservePrice = in.get<Money>();
+        item.startTime = fromWallNanos(in.get<int64_t>());
+        item.endTime = fromWallNanos(in.get<int64_t>());
+        item.isActive = in.get<uint8_t>() != 0;
+        return item;
+    }
+
+    void logCreate(const Item& item) {
+        if (!journaled)
+            return;
+        BinaryWriter record;
+        record.put(RecordType::CreateAuction);
+        writeItem(record, item);
+        journal.append(record);
+    }
+
+    // Inside a batch, this and logProxy() add to the batch's record instead.
+    void logBid(Id itemId, Id userId, Money amount, time_point<steady_clock> timestamp, BidBatch* batch = nullptr) {
+        if (!journaled)
+            return;
+        BinaryWriter single;
+        BinaryWriter& record = batch ? batch->record : single;
+        record.put(RecordType::Bid);
+        record.put(itemId);
+        record.put(userId);
+        record.put(amount);
+        record.put(toWallNanos(timestamp));
+        if (!batch)
+            journal.append(record);
+    }
+
+    // Records the outcome rather than re-deriving it on replay, so recovery
+    // does not depend on the relative order of concurrent balance changes.
+    void logSettle(Id itemId, SettleResult result, Id winner, Money price, bool charged) {
+        if (!journaled)
+            return;
+        BinaryWriter record;
+        record.put(RecordType::Settle);
+        record.put(itemId);
+        record.put(result);
+        record.put(winner);
+        record.put(price);
+        record.put((uint8_t)charged);
+        journal.append(record);
+    }
+
+    // A ceiling of 0 records the proxy being withdrawn.
+    void logProxy(Id itemId, Id userId, Money ceiling, BidBatch* batch = nullptr) {
+        if (!journaled)
+            return;
+        BinaryWriter single;
+        BinaryWriter& record = batch ? batch->record : single;
+        record.put(RecordType::Proxy);
+        record.put(itemId);
+        record.put(userId);
+        record.put(ceiling);
+        if (!batch)
+            journal.append(record);
+    }
+
+    void logBalance(Id userId, Money amount) {
+        if (!journaled)
+            return;
+        BinaryWriter record;
+        record.put(RecordType::Balance);
+        record.put(userId);
+        record.put(amount);
+        journal.append(record);
+    }
+
+    // -------- recovery --------
+    User* restoreUser(Id userId, const string& username, const string& email, Money balance) {
+        ids.ensure(userId);
+        usernameIndex.emplace(username, userId);
+        return users.emplace(userId, userId, username, email, balance).first;
+    }
+
+    Auction* restoreAuction(Item&& newItem) {
+        ids.ensure(newItem.id);
+        Auction* auction = auctions.emplace(newItem.id, move(newItem)).first;
+        const Item& item = auction->getItem();
+        userAuctions.update(item.sellerId, [&](vector<Id>& items) { items.push_back(item.id); });
+        list(*auction);
+        return auction;
+    }
+
+    // A Batch record is appended once its batch has unlocked every auction,
+    // so an auction in it may have been settled, and its Settle record
+    // written, first; its bids still go into its history, but not back into
+    // the live indexes.
+    bool applyRecord(BinaryReader& in, bool nested = false) {
+        RecordType type = in.get<RecordType>();
+        if (type == RecordType::Register) {
+            Id userId = in.get<Id>();
+            string username = in.getString();
+            string email = in.getString();
+            Money balance = in.get<Money>();
+            if (in.ok())
+                restoreUser(userId, username, email, balance);
+        } else if (type == RecordType::CreateAuction) {
+            Item item = readItem(in);
+            if (in.ok())
+                restoreAuction(move(item));
+        } else if (type == RecordType::Bid) {
+            Id itemId = in.get<Id>();
+            Id userId = in.get<Id>();
+            Money amount = in.get<Money>();
+            auto timestamp = fromWallNanos(in.get<int64_t>());
+            Auction* auction = auctions.find(itemId);
+            User* user = users.find(userId);
+            if (!in.ok() || !auction || !user)
+                return false;
+            auction->restoreBid(Bid(userId, amount, itemId, timestamp));
+            bool live = auction->getItem().isActive;
+            if (live)
+                priceChanged(*auction);
+            spill(itemId, *auction, !live);
+            recordActivity(*user, Activity::Bid, itemId);
+        } else if (type == RecordType::Batch && !nested) {
+            while (in.ok() && !in.atEnd())
+                if (!applyRecord(in, true))
+                    return false;
+        } else if (type == RecordType::Settle) {
+            Id itemId = in.get<Id>();
+            SettleResult result = in.get<SettleResult>();
+            Id winner = in.get<Id>();
+            Money price = in.get<Money>();
+            bool charged = in.get<uint8_t>() != 0;
+            Auction* auction = auctions.find(itemId);
+            if (!in.ok() || !auction)
+                return false;
+            auction->endAuction();
+            delist(*auction);
+            spill(itemId, *auction, true);
+            if (result == SettleResult::Sold) {
+                User& buyer = *users.find(winner);
+                User& seller = *users.find(auction->getItem().sellerId);
+                if (charged)
+                    buyer.deductBalance(price);
+                recordActivity(buyer, Activity::Owned, itemId);
+                seller.addBalance(price);
+                recordActivity(seller, Activity::Sold, itemId);
+            }
+        } else if (type == RecordType::Balance) {
+            Id userId = in.get<Id>();
+            Money amount = in.get<Money>();
+            User* user = users.find(userId);
+            if (!in.ok() || !user)
+                return false;
+            user->addBalance(amount);
+        } else if (type == RecordType::Proxy) {
+            // The bids the proxy went on to place follow as their own records.
+            Id itemId = in.get<Id>();
+            Id userId = in.get<Id>();
+            Money ceiling = in.get<Money>();
+            Auction* auction = auctions.find(itemId);
+            if (!in.ok() || !auction)
+                return false;
+            if (ceiling > Money())
+                auction->setProxy(userId, ceiling);
+            else
+                auction->dropProxy(userId);
+        } else {
+            return false;
+        }
+        return in.ok();
+    }
+
+    // Replays records from `wal` (after its 16-byte header); returns the length
+    // of the valid prefix so a torn tail can be truncated away.
+    uint64_t replayJournal(const vector<char>& wal) {
+        size_t pos = 16;
+        while (wal.size() - pos >= 8) {
+            uint32_t size, sum;
+            memcpy(&size, wal.data() + pos, 4);
+            memcpy(&sum, wal.data() + pos + 4, 4);
+            if (wal.size() - pos - 8 < size || checksum(wal.data() + pos + 8, size) != sum)
+                break;
+            BinaryReader in(wal.data() + pos + 8, size);
+            if (!applyRecord(in))
+                break;
+            pos += 8 + size;
+        }
+        return pos;
+    }
+
+    static const char* snapshotMagic() { return "AUCSNP04"; }
+
+    // Layout: "AUCSNP04", uint64 generation, uint32 checksum, body.
+    bool writeSnapshot(const string& path, uint64_t snapshotGeneration) const {
+        BinaryWriter body;
+        body.put((uint32_t)ids.size());
+        body.put(archive.size());
+        body.put(activityArchive.size());
+
+        vector<const User*> userList;
+        users.forEach([&](Id, const User& user) { userList.push_back(&user); });
+        body.put((uint32_t)userList.size());
+        for (const User* user : userList) {
+            lock_guard<mutex> guard(user->lock);
+            body.put(user->id);
+            body.putString(user->username);
+            body.putString(user->email);
+            body.put(user->balance);
+            for (const User::Ring* ring : { &user->bidHistory, &user->ownedItems, &user->soldItems }) {
+                body.put(ring->count());
+                body.putVector(ring->recent());
+            }
+        }
+
+        vector<const Auction*> auctionList;
+        auctions.forEach([&](Id, const Auction& auction) { auctionList.push_back(&auction); });
+        body.put((uint32_t)auctionList.size());
+        for (const Auction* auction : auctionList) {
+            lock_guard<mutex> guard(auction->lock);
+            writeItem(body, auction->getItem());
+            // Archived runs are already durable in the archive; only the
+            // in-memory window goes into the snapshot.
+            BidColumns recent = auction->recentBids();
+            body.put((uint32_t)recent.count);
+            body.putVector(vector<Id>(recent.users, recent.users + recent.count));
+            body.putVector(vector<Money>(recent.amounts, recent.amounts + recent.count));
+            body.putVector(vector<int64_t>(recent.timestamps, recent.timestamps + recent.count));
+
+            vector<Id> proxyUsers;
+            vector<Money> proxyCeilings;
+            auction->forEachProxy([&](const typename Auction::Proxy& proxy) {
+                proxyUsers.push_back(proxy.userId);
+                proxyCeilings.push_back(proxy.ceiling);
+            });
+            body.putVector(proxyUsers);
+            body.putVector(proxyCeilings);
+        }
+
+        BinaryWriter header;
+        header.buffer.assign(snapshotMagic(), snapshotMagic() + 8);
+        header.put(snapshotGeneration);
+        header.put(checksum(body.buffer.data(), body.buffer.size()));
+
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool ok = fwrite(header.buffer.data(), 1, header.buffer.size(), file) == header.buffer.size() &&
+                  fwrite(body.buffer.data(), 1, body.buffer.size(), file) == body.buffer.size() &&
+                  fflush(file) == 0 && fsync(fileno(file)) == 0;
+        return fclose(file) == 0 && ok;
+    }
+
+    bool loadSnapshot(const vector<char>& data, uint64_t& snapshotGeneration) {
+        if (data.size() < 20 || memcmp(data.data(), snapshotMagic(), 8) != 0)
+            return false;
+        BinaryReader header(data.data() + 8, 12);
+        snapshotGeneration = header.get<uint64_t>();
+        uint32_t sum = header.get<uint32_t>();
+        if (checksum(data.data() + 20, data.size() - 20) != sum)
+            return false;
+
+        BinaryReader in(data.data() + 20, data.size() - 20);
+        ids.ensure(in.get<uint32_t>());
+        if (!archive.open(archivePath(), in.get<uint64_t>()) ||
+            !activityArchive.open(activityPath(), in.get<uint64_t>()))
+            return false;
+
+        uint32_t userCount = in.get<uint32_t>();
+        for (uint32_t i = 0; i < userCount && in.ok(); i++) {
+            Id userId = in.get<Id>();
+            string username = in.getString();
+            string email = in.getString();
+            Money balance = in.get<Money>();
+            User* user = restoreUser(userId, username, email, balance);
+            for (User::Ring* ring : { &user->bidHistory, &user->ownedItems, &user->soldItems }) {
+                uint64_t lifetime = in.get<uint64_t>();
+                ring->restore(lifetime, in.getVector<Id>());
+            }
+        }
+
+        uint32_t auctionCount = in.get<uint32_t>();
+        for (uint32_t i = 0; i < auctionCount && in.ok(); i++) {
+            Auction* auction = restoreAuction(readItem(in));
+            Id itemId = auction->getItem().id;
+            archive.visit(itemId, [&](const BidColumns& run) { auction->restoreArchived(run); });
+
+            uint32_t recentCount = in.get<uint32_t>();
+            vector<Id> recentUsers = in.getVector<Id>();
+            vector<Money> recentAmounts = in.getVector<Money>();
+            vector<int64_t> recentTimes = in.getVector<int64_t>();
+            if (recentUsers.size() != recentCount || recentAmounts.size() != recentCount || recentTimes.size() != recentCount)
+                return false;
+            auction->restoreRecent({ recentUsers.data(), recentAmounts.data(), recentTimes.data(), recentCount });
+
+            // Written best first, so re-adding in order keeps the tie-break order.
+            vector<Id> proxyUsers = in.getVector<Id>();
+            vector<Money> proxyCeilings = in.getVector<Money>();
+            if (proxyUsers.size() != proxyCeilings.size())
+                return false;
+            for (size_t p = 0; p < proxyUsers.size(); p++)
+                auction->setProxy(proxyUsers[p], proxyCeilings[p]);
+            if (auction->getItem().isActive)
+                priceChanged(*auction);
+            else
+                auction->releaseHistory();
+        }
+        return in.ok() && in.atEnd();
+    }
+
+    string snapshotPath() const { return dataDirectory + "/auction.snap"; }
+    string journalPath() const { return dataDirectory + "/auction.wal"; }
+
+    // Makes renames inside the data directory durable.
+    bool syncDirectory() const {
+        int directory = ::open(dataDirectory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directory < 0)
+            return false;
+        bool ok = fsync(directory) == 0;
+        ::close(directory);
+        return ok;
+    }
+    string archivePath() const { return dataDirectory + "/bids.arc"; }
+    string activityPath() const { return dataDirectory + "/activity.arc"; }
+
+    // Adds to one of the user's rings; call with the user's lock held. With
+    // a data directory open, a full ring first moves its older half to the
+    // activity archive, so userActivity() can still page through it.
+    void recordActivity(User& user, Activity kind, Id itemId) {
+        User::Ring& ring = user.activity(kind);
+        if (kind == Activity::Bid && ring.newest() == itemId) {
+            ring.repeat();
+            return;
+        }
+        if (ring.full() && activityArchive.isOpen()) {
+            array<Id, User::RECENT / 2> oldest;
+            for (size_t i = 0; i < oldest.size(); i++)
+                oldest[i] = ring[i];
+            // If the archive cannot take them the ring just overwrites its
+            // oldest entry, as it does with no archive.
+            if (activityArchive.append(user.id, (uint32_t)kind, oldest.data(), oldest.size()))
+                ring.dropOldest(oldest.size());
+        }
+        ring.push(itemId);
+    }
+
+    // Moves bids from the live window into the archive: everything once the
+    // auction closes, otherwise the oldest part whenever the window doubles.
+    // Bids the archive could not take stay in memory and are retried on the
+    // next spill; a closed auction then keeps its history.
+    void spill(Id itemId, Auction& auction, bool closing) {
+        if (!archive.isOpen())
+            return;
+        BidColumns recent = auction.recentBids();
+        size_t count = closing ? recent.count
+                     : recent.count >= 2 * HISTORY_WINDOW ? recent.count - HISTORY_WINDOW : 0;
+        if (!archive.append(itemId, recent, count))
+            return;
+        auction.dropOldest(count);
+        if (closing)
+            auction.releaseHistory();
+    }
+
+    static Event bidEvent(Id itemId, Id userId, Money amount, BidResult result) {
+        EventType type = result == BidResult::Accepted ? EventType::BidAccepted : EventType::BidRejected;
+        return { type, result, SettleResult::Sold, itemId, userId, amount };
+    }
+
+    BidResult publishBid(Id itemId, Id userId, Money amount, BidResult result) {
+        metrics.count(result);
+        sink->publish(bidEvent(itemId, userId, amount, result));
+        return result;
+    }
+
+    void publishBids(const vector<Event>& events) {
+        for (const Event& event : events)
+            metrics.count(event.bidResult);
+        sink->publishAll(events.data(), events.size());
+    }
+
+    // Closes the auction and decides its outcome and the price the leader
+    // pays, without touching any user. Returns AlreadyEnded if it was settled
+    // before, manually or by the expiry wheel.
+    SettleResult closeAuction(Id itemId, Auction& auction, Bid& highestBid, Money& price) {
+        lock_guard<mutex> guard(auction.lock);
+        if (!auction.getItem().isActive)
+            return SettleResult::AlreadyEnded;
+
+        auction.endAuction();
+        delist(auction);
+        spill(itemId, auction, true);
+        highestBid = auction.getHighestBid();
+        price = highestBid.amount;
+        if (highestBid.userId == NO_ID)
+            return SettleResult::NoBids;
+        if (!auction.hasReserveBeenMet())
+            return SettleResult::ReserveNotMet;
+        price = auction.getClearingPrice();
+        return SettleResult::Sold;
+    }
+
+    // Closes the auction and applies the winner/reserve outcome. Callers hold
+    // mutationScope().
+    SettleResult settleAuction(Id itemId, Auction& auction) {
+        OpTimer timer(metrics, TimedOp::EndAuction);
+        Bid highestBid;
+        Money price;
+        SettleResult result = closeAuction(itemId, auction, highestBid, price);
+        if (result == SettleResult::AlreadyEnded) {
+            metrics.count(result);
+            return result;
+        }
+
+        bool charged = false;
+        if (result == SettleResult::ReserveNotMet) {
+            User& leader = *users.find(highestBid.userId);
+            lock_guard<mutex> guard(leader.lock);
+            leader.release(highestBid.amount);
+        } else if (result == SettleResult::Sold) {
+            // The seller id is immutable after creation, so reading it unlocked is safe.
+            User& buyer = *users.find(highestBid.userId);
+            User& seller = *users.find(auction.getItem().sellerId);
+            {
+                // The winning amount has been escrowed since the bid was accepted;
+                // a second-price sale hands back the difference.
+                lock_guard<mutex> guard(buyer.lock);
+                charged = true;
+                buyer.release(highestBid.amount - price);
+                buyer.capture(price);
+                recordActivity(buyer, Activity::Owned, itemId);
+            }
+            {
+                lock_guard<mutex> guard(seller.lock);
+                seller.addBalance(price);
+                recordActivity(seller, Activity::Sold, itemId);
+            }
+        }
+
+        Id winner = result == SettleResult::Sold ? highestBid.userId : NO_ID;
+        metrics.count(result);
+        logSettle(itemId, result, winner, price, charged);
+        sink->publish({ EventType::AuctionSettled, BidResult::Accepted, result, itemId, winner, price });
+        return result;
+    }
+
+    // -------- batch settlement --------
+    // Runs fn(i) for every i < count on up to hardware_concurrency threads,
+    // handing out indices `chunk` at a time; small counts stay on the caller.
+    template <typename F>
+    static void parallelFor(size_t count, F fn, size_t chunk = 512) {
+        size_t workers = min<size_t>(max(1u, thread::hardware_concurrency()), (count + chunk - 1) / chunk);
+        atomic<size_t> next{ 0 };
+        auto work = [&] {
+            for (size_t begin; (begin = next.fetch_add(chunk)) < count;)
+                for (size_t i = begin; i < min(count, begin + chunk); i++)
+                    fn(i);
+        };
+        vector<thread> pool;
+        for (size_t w = 1; w < workers; w++)
+            pool.emplace_back(work);
+        work();
+        for (auto& worker : pool)
+            worker.join();
+    }
+
+    struct Settlement {
+        Id itemId;
+        Id sellerId;
+        Bid highestBid;
+        Money price; // paid by the leader on a sale
+        SettleResult result;
+    };
+
+    // One user's share of a settlement batch, applied under a single lock.
+    struct Ledger {
+        Money captured; // won; escrowed since the bid was accepted
+        Money released; // held beyond what is paid: reserve not met, or a second-price sale
+        Money credited; // sold
+        vector<Id> owned;
+        vector<Id> sold;
+    };
+
+    // Users are split into partitions by id; each partition folds its users'
+    // entries from every settlement, in order, then applies them, so a seller
+    // closing thousands of auctions takes its lock once.
+    void applySettlements(const vector<Settlement>& settled) {
+        size_t partitions = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), settled.size() / 4096));
+
+        // One pass buckets each entry under its buyer's and its seller's
+        // partition; bit 31 of the index marks the seller's copy.
+        static const uint32_t AS_SELLER = 1u << 31;
+        vector<vector<uint32_t>> buckets(partitions);
+        for (uint32_t i = 0; i < (uint32_t)settled.size(); i++) {
+            const Settlement& entry = settled[i];
+            if (entry.result == SettleResult::Sold || entry.result == SettleResult::ReserveNotMet)
+                buckets[entry.highestBid.userId % partitions].push_back(i);
+            if (entry.result == SettleResult::Sold)
+                buckets[entry.sellerId % partitions].push_back(i | AS_SELLER);
+        }
+
+        parallelFor(partitions, [&](size_t partition) {
+            unordered_map<Id, Ledger> ledgers;
+            for (uint32_t tagged : buckets[partition]) {
+                const Settlement& entry = settled[tagged & ~AS_SELLER];
+                if (tagged & AS_SELLER) {
+                    ledgers[entry.sellerId].credited += entry.price;
+                    ledgers[entry.sellerId].sold.push_back(entry.itemId);
+                } else if (entry.result == SettleResult::Sold) {
+                    Ledger& ledger = ledgers[entry.highestBid.userId];
+                    ledger.captured += entry.price;
+                    ledger.released += entry.highestBid.amount - entry.price;
+                    ledger.owned.push_back(entry.itemId);
+                } else {
+                    ledgers[entry.highestBid.userId].released += entry.highestBid.amount;
+                }
+            }
+            for (auto& pair : ledgers) {
+                User& user = *users.find(pair.first);
+                Ledger& ledger = pair.second;
+                lock_guard<mutex> guard(user.lock);
+                user.release(ledger.released);
+                user.capture(ledger.captured);
+                user.addBalance(ledger.credited);
+                for (Id itemId : ledger.owned)
+                    recordActivity(user, Activity::Owned, itemId);
+                for (Id itemId : ledger.sold)
+                    recordActivity(user, Activity::Sold, itemId);
+            }
+        }, 1);
+    }
+
+public:
+    // Events go to a no-op sink unless one is installed; the sink must outlive
+    // the system or be replaced before it is destroyed.
+    void setEventSink(EventSink* eventSink) {
+        sink = eventSink ? eventSink : &noopSink;
+    }
+
+    // Records every later entry-point call (see OpRecorder); nullptr stops.
+    // Set before other threads use the system.
+    void setRecorder(OpRecorder* opRecorder) {
+        recorder = opRecorder;
+    }
+
+    // Returns the new user's id, or NO_ID if the username is taken.
+    Id registerUser(const string& username, const string& email, Money initialBalance = Money::units(1000)) {
+        return addUser(username, email, initialBalance);
+    }
+
+    // Bulk registration: reserves once; returns how many were registered.
+    int registerUsers(const vector<UserRegistration>& batch) {
+        users.reserve(batch.size());
+        usernameIndex.reserve(batch.size());
+
+        int registered = 0;
+        for (const auto& reg : batch)
+            if (addUser(reg.username, reg.email, reg.initialBalance) != NO_ID)
+                registered++;
+        return registered;
+    }
+
+    Id findUser(const string& username) const {
+        const Id* userId = usernameIndex.find(username);
+        return userId ? *userId : NO_ID;
+    }
+
+    // Opens a session for the user; NO_SESSION if the username is unknown.
+    // Any number of sessions, for the same or different users, can be open.
+    SessionId login(const string& username) {
+        OpTimer timer(metrics, TimedOp::Login);
+        Id userId = findUser(username);
+        SessionId session = userId == NO_ID ? NO_SESSION : sessions.open(userId);
+        capture(CapturedOp::Login, username, session);
+        return session;
+    }
+
+    void logout(SessionId session) {
+        capture(CapturedOp::Logout, session);
+        sessions.close(session);
+    }
+
+    // O(1) and lock-free; NO_ID once the session is closed.
+    Id sessionUser(SessionId session) const {
+        return sessions.find(session);
+    }
+
+    Id createAuction(SessionId session, string itemName, string description, Money startingPrice, Money reservePrice,
+                     int durationMinutes) {
+        return createAuctionAs(sessionUser(session), move(itemName), move(description), startingPrice, reservePrice,
+                               durationMinutes);
+    }
+
+    // Returns the new item's id, or NO_ID if no seller is given.
+    Id createAuctionAs(Id sellerId, string itemName, string description, Money startingPrice, Money reservePrice, int durationMinutes) {
+        if (sellerId == NO_ID) {
+            capture(CapturedOp::CreateAuction, sellerId, itemName, description, startingPrice, reservePrice,
+                    durationMinutes, NO_ID);
+            return NO_ID;
+        }
+
+        OpTimer timer(metrics, TimedOp::CreateAuction);
+        auto scope = mutationScope();
+        Id itemId;
+        {
+            unique_lock<mutex> ordered = recorder ? unique_lock<mutex>(captureOrder) : unique_lock<mutex>();
+            itemId = generateId();
+            capture(CapturedOp::CreateAuction, sellerId, itemName, description, startingPrice, reservePrice,
+                    durationMinutes, itemId);
+        }
+        Item item(itemId, move(itemName), move(description), startingPrice, reservePrice, sellerId, durationMinutes);
+        logCreate(item);
+        Auction* auction = auctions.emplace(itemId, move(item)).first;
+        {
+            lock_guard<mutex> guard(auction->lock);
+            list(*auction);
+        }
+        userAuctions.update(sellerId, [&](vector<Id>& items) { items.push_back(itemId); });
+        return itemId;
+    }
+
+    BidResult placeBid(SessionId session, const string& itemId, Money amount) {
+        return placeBid(session, ids.find(itemId), amount);
+    }
+
+    BidResult placeBid(SessionId session, Id itemId, Money amount) {
+        return placeBidAs(sessionUser(session), itemId, amount);
+    }
+
+    // Thread-safe entry point: bids on different auctions never share a lock.
+    BidResult placeBidAs(Id userId, Id itemId, Money amount) {
+        capture(CapturedOp::Bid, userId, itemId, amount);
+        OpTimer timer(metrics, TimedOp::PlaceBid);
+        auto scope = mutationScope();
+        User* user = userId == NO_ID ? nullptr : users.find(userId);
+        if (!user)
+            return publishBid(itemId, userId, amount, BidResult::NotLoggedIn);
+
+        Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return publishBid(itemId, userId, amount, BidResult::AuctionNotFound);
+
+        {
+            lock_guard<mutex> guard(user->lock);
+            if (!user->canBid(amount))
+                return publishBid(itemId, userId, amount, BidResult::InsufficientBalance);
+        }
+
+        BidResult result;
+        vector<Bid> proxyBids;
+        {
+            lock_guard<mutex> guard(auction->lock);
+            auto timestamp = engineNow();
+            result = auction->checkBid(userId, amount, timestamp);
+            if (result == BidResult::Accepted && !escrow(*auction, *user, amount))
+                result = BidResult::InsufficientBalance;
+            if (result == BidResult::Accepted) {
+                auction->acceptBid(userId, amount, timestamp);
+                logBid(itemId, userId, amount, timestamp);
+                resolveProxies(*auction, timestamp, timestamp, proxyBids);
+                priceChanged(*auction);
+                spill(itemId, *auction, false);
+            }
+        }
+
+        if (result == BidResult::Accepted) {
+            lock_guard<mutex> guard(user->lock);
+            recordActivity(*user, Activity::Bid, itemId);
+        }
+        publishBid(itemId, userId, amount, result);
+        publishProxyBids(proxyBids);
+        if (Policy::CLOSES_ON_BID && result == BidResult::Accepted)
+            settleAuction(itemId, *auction);
+        return result;
+    }
+
+    BidResult placeProxyBid(SessionId session, const string& itemId, Money ceiling) {
+        return placeProxyBid(session, ids.find(itemId), ceiling);
+    }
+
+    BidResult placeProxyBid(SessionId session, Id itemId, Money ceiling) {
+        return placeProxyBidAs(sessionUser(session), itemId, ceiling);
+    }
+
+    // Registers (or replaces) a proxy bid: the engine bids for the user, one
+    // BID_INCREMENT above the strongest rival, up to `ceiling`. The ceiling is
+    // validated like a bid; Accepted means the proxy was registered, and the
+    // bids it then places are published as BidAccepted events. O(log n) in the
+    // number of proxies on the auction. Formats without proxies return
+    // NotActive.
+    BidResult placeProxyBidAs(Id userId, Id itemId, Money ceiling) {
+        capture(CapturedOp::ProxyBid, userId, itemId, ceiling);
+        if (!Policy::PROXIES)
+            return BidResult::NotActive;
+        OpTimer timer(metrics, TimedOp::PlaceProxyBid);
+        auto scope = mutationScope();
+        User* user = userId == NO_ID ? nullptr : users.find(userId);
+        if (!user)
+            return BidResult::NotLoggedIn;
+
+        Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return BidResult::AuctionNotFound;
+
+        {
+            lock_guard<mutex> guard(user->lock);
+            if (!user->canBid(ceiling))
+                return BidResult::InsufficientBalance;
+        }
+
+        BidResult result;
+        vector<Bid> proxyBids;
+        {
+            lock_guard<mutex> guard(auction->lock);
+            auto timestamp = engineNow();
+            result = auction->checkBid(userId, ceiling, timestamp);
+            if (result == BidResult::Accepted) {
+                logProxy(itemId, userId, ceiling);
+                auction->setProxy(userId, ceiling);
+                resolveProxies(*auction, timestamp, timestamp, proxyBids);
+                if (!proxyBids.empty()) {
+                    priceChanged(*auction);
+                    spill(itemId, *auction, false);
+                }
+            }
+        }
+        publishProxyBids(proxyBids);
+        return result;
+    }
+
+    // Batch ingestion: requests are grouped by item and applied in timestamp
+    // order, so each auction is locked once. Each bidder is resolved once and
+    // takes its lock twice per batch: to reserve up front the most its bids
+    // could hold (the sum of its highest bid on each item, capped by what it
+    // has free), and at the end to release what they did not draw and record
+    // its activity. The accepted bids, and what the proxies did in answer, are
+    // journaled as one Batch record, and each auction's events are published
+    // in one call.
+    // Nothing is printed; results[i] corresponds to requests[i].
+    vector<BidResult> placeBids(const vector<BidRequest>& requests) {
+        capture(CapturedOp::Bids, requests);
+        OpTimer timer(metrics, TimedOp::PlaceBids);
+        auto scope = mutationScope();
+        vector<BidResult> results(requests.size(), BidResult::NotLoggedIn);
+
+        vector<size_t> order(requests.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (requests[a].itemId != requests[b].itemId)
+                return requests[a].itemId < requests[b].itemId;
+            if (requests[a].timestamp != requests[b].timestamp)
+                return requests[a].timestamp < requests[b].timestamp;
+            return a < b;
+        });
+
+        BidBatch batch;
+        batch.bidders.reserve(requests.size());
+        for (size_t i : order) {
+            const BidRequest& req = requests[i];
+            auto slot = batch.bidders.try_emplace(req.userId);
+            typename BidBatch::Bidder& bidder = slot.first->second;
+            if (slot.second)
+                bidder.user = req.userId == NO_ID ? nullptr : users.find(req.userId);
+            if (bidder.lastItem != req.itemId) {
+                bidder.lastItem = req.itemId;
+                bidder.itemHigh = Money();
+            }
+            if (req.amount > bidder.itemHigh) {
+                bidder.exposure += req.amount - bidder.itemHigh;
+                bidder.itemHigh = req.amount;
+            }
+        }
+
+        batch.record.put(RecordType::Batch);
+        for (auto& entry : batch.bidders) {
+            typename BidBatch::Bidder& bidder = entry.second;
+            if (!bidder.user)
+                continue;
+            lock_guard<mutex> guard(bidder.user->lock);
+            bidder.balance = bidder.user->balance;
+            bidder.slack = max(Money(), min(bidder.exposure, bidder.user->available()));
+            bidder.user->reserved += bidder.slack;
+        }
+
+        auto now = engineNow();
+        vector<Event> events;
+        vector<Bid> proxyBids;
+        vector<pair<Id, Auction*>> closing; // won outright (CLOSES_ON_BID)
+        for (size_t begin = 0, end; begin < order.size(); begin = end) {
+            Id itemId = requests[order[begin]].itemId;
+            for (end = begin; end < order.size() && requests[order[end]].itemId == itemId; end++) {}
+
+            Auction* auction = auctions.find(itemId);
+            events.clear();
+            {
+                unique_lock<mutex> guard = auction ? unique_lock<mutex>(auction->lock) : unique_lock<mutex>();
+                bool accepted = false;
+                for (size_t k = begin; k < end; k++) {
+                    const BidRequest& req = requests[order[k]];
+                    typename BidBatch::Bidder& bidder = batch.bidders.find(req.userId)->second;
+                    BidResult& result = results[order[k]];
+                    if (bidder.user && !auction)
+                        result = BidResult::AuctionNotFound;
+                    else if (bidder.user && req.amount > bidder.balance) // as placeBidAs checks first
+                        result = BidResult::InsufficientBalance;
+                    else if (bidder.user)
+                        result = auction->checkBid(req.userId, req.amount, now);
+                    if (result == BidResult::Accepted && !escrow(*auction, *bidder.user, req.amount, &batch))
+                        result = BidResult::InsufficientBalance;
+                    if (result == BidResult::Accepted) {
+                        auction->acceptBid(req.userId, req.amount, req.timestamp);
+                        logBid(itemId, req.userId, req.amount, req.timestamp, &batch);
+                        batch.place(bidder, itemId);
+                        resolveProxies(*auction, req.timestamp, now, proxyBids, &batch);
+                        accepted = true;
+                    }
+                    events.push_back(bidEvent(itemId, req.userId, req.amount, result));
+                    for (const Bid& bid : proxyBids)
+                        events.push_back(bidEvent(bid.itemId, bid.userId, bid.amount, BidResult::Accepted));
+                    proxyBids.clear();
+                }
+                if (accepted) {
+                    priceChanged(*auction);
+                    spill(itemId, *auction, false);
+                    if (Policy::CLOSES_ON_BID)
+                        closing.push_back({ itemId, auction });
+                }
+            }
+            publishBids(events);
+        }
+
+        if (journaled && batch.record.buffer.size() > sizeof(RecordType))
+            journal.append(batch.record);
+        for (auto& entry : batch.bidders) {
+            typename BidBatch::Bidder& bidder = entry.second;
+            if (!bidder.user)
+                continue;
+            lock_guard<mutex> guard(bidder.user->lock);
+            bidder.user->release(bidder.slack);
+            for (uint32_t at = bidder.firstPlaced; at != UINT32_MAX; at = batch.placed[at].next)
+                recordActivity(*bidder.user, Activity::Bid, batch.placed[at].itemId);
+        }
+        for (auto& entry : closing)
+            settleAuction(entry.first, *entry.second);
+        return results;
+    }
+
+    typedef LiveIndex<time_point<steady_clock>>::Cursor EndCursor;
+    typedef LiveIndex<Money, greater<Money>>::Cursor PriceCursor;
+
+    // Paged listings over live auctions. Pass the last entry of the previous
+    // page as `after` to continue; each call is O(log n + limit).
+    vector<EndCursor> endingSoonest(size_t limit, const EndCursor* after = nullptr) const {
+        return endingIndex.page(limit, after);
+    }
+
+    vector<PriceCursor> topByPrice(size_t limit, const PriceCursor* after = nullptr) const {
+        return priceIndex.page(limit, after);
+    }
+
+    // Live auctions whose name or description contains every word of
+    // `query` ("word*" for a prefix), ranked by SearchRank. Never scans the
+    // auction map; see SearchIndex.
+    // `truncated`: see SearchIndex::search.
+    vector<Id> search(const string& query, SearchRank rank = SearchRank::Price, size_t limit = 20,
+                      bool* truncated = nullptr) const {
+        return searchIndex.search(query, rank, limit, engineNow(), truncated);
+    }
+
+    SettleResult endAuction(const string& itemId) {
+        return endAuction(ids.find(itemId));
+    }
+
+    SettleResult endAuction(Id itemId) {
+        capture(CapturedOp::EndAuction, itemId);
+        Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return SettleResult::AuctionNotFound;
+        auto scope = mutationScope();
+        return settleAuction(itemId, *auction);
+    }
+
+    // Settles every auction whose end time has passed; returns how many closed.
+    int expireAuctions(time_point<steady_clock> now) {
+        capture(CapturedOp::ExpireAuctions, now);
+        vector<Id> due;
+        expiry.advance(now, due);
+        repriceLive(now);
+
+        auto scope = mutationScope();
+        int settled = 0;
+        for (Id itemId : due)
+            if (settleAuction(itemId, *auctions.find(itemId)) != SettleResult::AlreadyEnded)
+                settled++;
+        return settled;
+    }
+
+    // Batch form of expireAuctions for mass closings: winners are decided on
+    // a pool of threads (each auction locked once, outcomes journaled
+    // there), then the balance transfers are grouped by user and applied
+    // with one lock per user. Events are published afterwards, in expiry
+    // order. Returns how many auctions closed.
+    int settleExpired(time_point<steady_clock> now) {
+        capture(CapturedOp::SettleExpired, now);
+        OpTimer timer(metrics, TimedOp::SettleExpired);
+        vector<Id> due;
+        expiry.advance(now, due);
+        repriceLive(now);
+        if (due.empty())
+            return 0;
+
+        auto scope = mutationScope();
+        vector<Settlement> settled(due.size());
+        parallelFor(due.size(), [&](size_t i) {
+            Settlement& entry = settled[i];
+            Auction& auction = *auctions.find(due[i]);
+            entry.itemId = due[i];
+            entry.sellerId = auction.getItem().sellerId;
+            entry.result = closeAuction(due[i], auction, entry.highestBid, entry.price);
+            if (entry.result == SettleResult::AlreadyEnded)
+                return;
+            Id winner = entry.result == SettleResult::Sold ? entry.highestBid.userId : NO_ID;
+            logSettle(entry.itemId, entry.result, winner, entry.price, entry.result == SettleResult::Sold);
+        });
+        applySettlements(settled);
+
+        int count = 0;
+        for (const Settlement& entry : settled) {
+            metrics.count(entry.result);
+            if (entry.result == SettleResult::AlreadyEnded)
+                continue;
+            Id winner = entry.result == SettleResult::Sold ? entry.highestBid.userId : NO_ID;
+            sink->publish({ EventType::AuctionSettled, BidResult::Accepted, entry.result, entry.itemId, winner,
+                            entry.price });
+            count++;
+        }
+        return count;
+    }
+
+    bool addBalance(SessionId session, Money amount) {
+        return addBalanceAs(sessionUser(session), amount);
+    }
+
+    // Negative amounts withdraw; false if that would leave less than the
+    // user's bids hold in escrow.
+    bool addBalanceAs(Id userId, Money amount) {
+        capture(CapturedOp::AddBalance, userId, amount);
+        User* found = userId == NO_ID ? nullptr : users.find(userId);
+        if (!found)
+            return false;
+
+        auto scope = mutationScope();
+        User& user = *found;
+        lock_guard<mutex> guard(user.lock);
+        if (user.balance + amount < user.reserved)
+            return false;
+        user.addBalance(amount);
+        logBalance(userId, amount);
+        return true;
+    }
+
+    Money getBalance(Id userId) const {
+        const User* user = users.find(userId);
+        if (!user)
+            return Money();
+        lock_guard<mutex> guard(user->lock);
+        return user->balance;
+    }
+
+    // One page of a user's activity, newest first: skips `offset` entries and
+    // returns up to `limit`. The most recent User::RECENT come from memory;
+    // older ones are read from the activity archive, so they are only
+    // available with a data directory open.
+    vector<Id> userActivity(Id userId, Activity kind, size_t offset, size_t limit) const {
+        vector<Id> page;
+        const User* user = users.find(userId);
+        if (!user)
+            return page;
+        lock_guard<mutex> guard(user->lock); // keeps a spill from moving entries mid-read
+        auto take = [&](const Id* ids, size_t count) {
+            for (size_t i = count; i-- > 0 && page.size() < limit;) {
+                if (offset)
+                    offset--;
+                else
+                    page.push_back(ids[i]);
+            }
+            return page.size() < limit;
+        };
+        vector<Id> recent = user->activity(kind).recent();
+        if (take(recent.data(), recent.size()))
+            activityArchive.visit(userId, (uint32_t)kind, take);
+        return page;
+    }
+
+    // Lifetime count of one kind of activity; O(1).
+    uint64_t activityCount(Id userId, Activity kind) const {
+        const User* user = users.find(userId);
+        if (!user)
+            return 0;
+        lock_guard<mutex> guard(user->lock);
+        return user->activity(kind).count();
+    }
+
+    // Price streams: watch items on a subscription, then drain it with next()
+    // whenever its fd() becomes readable.
+    shared_ptr<PriceSubscription> subscribePrices() {
+        return prices.subscribe();
+    }
+
+    bool watchPrice(const shared_ptr<PriceSubscription>& subscription, Id itemId) {
+        Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return false;
+        // Under the auction lock, so no accepted bid falls between the
+        // starting price and the first publish.
+        lock_guard<mutex> guard(auction->lock);
+        prices.watch(subscription, itemId, auction->getCurrentPrice());
+        return true;
+    }
+
+    void unsubscribePrices(const shared_ptr<PriceSubscription>& subscription) {
+        prices.unsubscribe(subscription);
+    }
+
+    // Latency percentiles per call and bid/settlement counts by result,
+    // summed over every thread so far.
+    StatsSnapshot stats() const {
+        return metrics.snapshot();
+    }
+
+    string prometheusStats() const {
+        return prometheusText(stats());
+    }
+
+    // FNV-1a over every user's balance, escrow and activity counts and every
+    // auction's price, bid count, state and leader, in id order: two runs
+    // ended in the same state iff (barring collisions) the checksums match.
+    uint32_t stateChecksum() const {
+        BinaryWriter state;
+        for (Id id = 1; id <= (Id)ids.size(); id++) {
+            if (const User* user = users.find(id)) {
+                lock_guard<mutex> guard(user->lock);
+                state.put(id);
+                state.put(user->balance);
+                state.put(user->reserved);
+                for (Activity kind : { Activity::Bid, Activity::Owned, Activity::Sold })
+                    state.put(user->activity(kind).count());
+            } else if (const Auction* auction = auctions.find(id)) {
+                lock_guard<mutex> guard(auction->lock);
+                state.put(id);
+                state.put(auction->getView().price);
+                state.put((uint64_t)auction->getBidCount());
+                state.put((uint8_t)auction->getItem().isActive);
+                state.put(auction->getHighestBid().userId);
+            }
+        }
+        return checksum(state.buffer.data(), state.buffer.size());
+    }
+
+    // Lock-free: reads the auction's published view, so it never waits on
+    // (or delays) a bid.
+    bool getSummary(Id itemId, AuctionSummary& out) const {
+        const Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return false;
+        summarize(*auction, engineNow(), out);
+        return true;
+    }
+
+    // Recovers state from <directory>/auction.snap plus the auction.wal tail,
+    // then journals every later mutation there. Call once, on an empty system,
+    // before any other thread uses it.
+    bool open(const string& directory) {
+        dataDirectory = directory;
+        mkdir(directory.c_str(), 0755);
+
+        uint64_t snapshotGeneration = 0;
+        vector<char> snapshot;
+        if (readFile(snapshotPath(), snapshot)) {
+            if (!loadSnapshot(snapshot, snapshotGeneration))
+                return false;
+        } else if (!archive.open(archivePath(), 0) || !activityArchive.open(activityPath(), 0)) {
+            return false;
+        }
+
+        journaled = true;
+        vector<char> wal;
+        if (readFile(journalPath(), wal) && wal.size() >= 16 && memcmp(wal.data(), Journal::magic(), 8) == 0) {
+            uint64_t walGeneration;
+            memcpy(&walGeneration, wal.data() + 8, 8);
+            // An older generation was already folded into the snapshot.
+            if (walGeneration >= snapshotGeneration) {
+                uint64_t valid = replayJournal(wal);
+                rebuildEscrow();
+                generation = walGeneration;
+                return journal.reopen(journalPath(), valid);
+            }
+        }
+        rebuildEscrow();
+        generation = snapshotGeneration;
+        return journal.create(journalPath(), generation);
+    }
+
+    // Writes a snapshot of the whole state and starts a new, empty log
+    // generation. Mutations are paused for the duration. The new log is
+    // created beside the old one and swapped in only once the snapshot is in
+    // place, so on failure the previous snapshot and log stay in use. Also
+    // the way back from a failed log: the snapshot covers what it lost.
+    bool checkpoint() {
+        if (!journaled)
+            return false;
+
+        unique_lock<shared_mutex> quiesce(checkpointLock);
+        journal.sync();
+        archive.sync();
+        activityArchive.sync();
+
+        uint64_t next = generation + 1;
+        string snapshotTemp = snapshotPath() + ".tmp";
+        string journalTemp = journalPath() + ".tmp";
+        int fresh = -1;
+        if (!writeSnapshot(snapshotTemp, next) || (fresh = Journal::createFile(journalTemp, next)) < 0) {
+            unlink(snapshotTemp.c_str());
+            return false;
+        }
+        if (rename(snapshotTemp.c_str(), snapshotPath().c_str()) != 0) {
+            ::close(fresh);
+            unlink(snapshotTemp.c_str());
+            unlink(journalTemp.c_str());
+            return false;
+        }
+        // The snapshot now covers everything in the old log, and recovery
+        // ignores that log for being an older generation. So the new log must
+        // be in place before anything is written to it; if it cannot be, the
+        // old one is latched failed so that later records are reported lost
+        // and the next checkpoint covers them.
+        generation = next;
+        if (rename(journalTemp.c_str(), journalPath().c_str()) != 0 || !syncDirectory()) {
+            ::close(fresh);
+            unlink(journalTemp.c_str());
+            journal.fail();
+            return false;
+        }
+        journal.rotate(fresh);
+        return true;
+    }
+
+    // Checkpoints once the log has grown past `journalBytes`, or at once if
+    // it has failed. Returns false if records may have been lost and no
+    // checkpoint has recovered them yet.
+    bool maybeCheckpoint(uint64_t journalBytes = 64u << 20) {
+        if (!journaled)
+            return true;
+        if (!journal.healthy() || journal.size() > journalBytes)
+            return checkpoint();
+        return true;
+    }
+
+    // Visits the item's whole bid history oldest-first as column views:
+    // archived runs straight from the mapping, then the live window. Views
+    // are only valid inside fn.
+    template <typename F>
+    bool visitBidHistory(Id itemId, F fn) const {
+        const Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return false;
+        lock_guard<mutex> guard(auction->lock);
+        archive.visit(itemId, fn);
+        fn(auction->recentBids());
+        return true;
+    }
+
+    // Catalogue-wide sweeps over the AuctionTable columns; no per-auction locks.
+    vector<Id> activeAuctions(time_point<steady_clock> now) const {
+        vector<Id> out;
+        table.collect(now, false, out);
+        return out;
+    }
+
+    // Auctions past their end time that the expiry wheel has not settled yet.
+    vector<Id> expiredAuctions(time_point<steady_clock> now) const {
+        vector<Id> out;
+        table.collect(now, true, out);
+        return out;
+    }
+
+    // Calls fn(itemId, price) for each active auction, in table order.
+    template <typename F>
+    void forEachActivePrice(F fn) const {
+        table.forEachBlock([&](const AuctionTable::Block& block, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                if (block.active[i].load(memory_order_relaxed))
+                    fn(block.itemId[i], block.price[i].load(memory_order_relaxed));
+        });
+    }
+
+    // Calls fn(userId, highestAmount) for each bidder on the item, in place;
+    // nobody while a sealed auction runs.
+    template <typename F>
+    bool visitUserBids(Id itemId, F fn) const {
+        const Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return false;
+        lock_guard<mutex> guard(auction->lock);
+        if (auction->isSealed())
+            return true;
+        if (!auction->isReleased()) {
+            auction->forEachUserBid(fn);
+            return true;
+        }
+
+        unordered_map<Id, Money> highest;
+        archive.visit(itemId, [&](const BidColumns& run) {
+            for (size_t i = 0; i < run.count; i++)
+                highest[run.users[i]] = max(highest[run.users[i]], run.amounts[i]);
+        });
+        for (const auto& pair : highest)
+            fn(pair.first, pair.second);
+        return true;
+    }
+
+    // Calls fn(const Bid&) for the current top bidders, best first; nobody
+    // while a sealed auction runs.
+    template <typename F>
+    bool visitLeaders(Id itemId, F fn) const {
+        const Auction* auction = auctions.find(itemId);
+        if (!auction)
+            return false;
+        lock_guard<mutex> guard(auction->lock);
+        if (auction->isSealed())
+            return true;
+        for (const Bid& bid : auction->getLeaders())
+            fn(bid);
+        return true;
+    }
+
+    // Blocks until every mutation so far is on disk; false if the journal
+    // failed and some were not written (see maybeCheckpoint()).
+    bool sync() {
+        return !journaled || journal.sync();
+    }
+
+private:
+    // -------------------- Console --------------------
+    // Everything below is the interactive front end; the engine above never
+    // writes to cout.
+
+    // Prints settlements as they happen and forwards everything to the sink
+    // that was installed before run() started.
+    class ConsoleSink : public EventSink {
+    private:
+        const IdTable& ids;
+        EventSink* next;
+
+    public:
+        ConsoleSink(const IdTable& idTable, EventSink* nextSink) : ids(idTable), next(nextSink) {}
+
+        void publish(const Event& event) override {
+            if (event.type == EventType::AuctionSettled) {
+                cout << "\n=== Auction Ended ===" << endl;
+                if (event.settleResult == SettleResult::NoBids)
+                    cout << "No bids were placed. Item remains unsold." << endl;
+                else if (event.settleResult == SettleResult::ReserveNotMet)
+                    cout << "Reserve price not met. Item remains unsold." << endl;
+                else
+                    cout << "Item sold to " << ids.name(event.userId) << " for $" << event.amount << endl;
+            }
+            next->publish(event);
+        }
+    };
+
+    void printBidResult(Id userId, Id itemId, Money amount, BidResult result) const {
+        const Auction* auction = auctions.find(itemId);
+        switch (result) {
+            case BidResult::Accepted:
+                cout << "Bid placed successfully! Current highest bid: $" << amount << endl;
+                break;
+            case BidResult::NotLoggedIn:
+                cout << "Please login first!" << endl;
+                break;
+            case BidResult::AuctionNotFound:
+                cout << "Auction not found!" << endl;
+                break;
+            case BidResult::InsufficientBalance:
+                cout << "Insufficient balance! Your balance: $" << getBalance(userId) << endl;
+                break;
+            case BidResult::NotActive:
+                cout << "Auction is not active!" << endl;
+                break;
+            case BidResult::BelowStartingPrice:
+                cout << "Bid must be higher than starting price: $" << auction->getItem().startingPrice << endl;
+                break;
+            case BidResult::BelowHighestBid: {
+                lock_guard<mutex> guard(auction->lock);
+                cout << "Bid must be higher than current highest bid: $" << auction->getCurrentPrice() << endl;
+                break;
+            }
+            case BidResult::OwnItem:
+                cout << "Cannot bid on your own item!" << endl;
+                break;
+            case BidResult::InvalidAmount:
+                cout << "Invalid amount!" << endl;
+                break;
+            case BidResult::AlreadySold:
+                cout << "Item already sold!" << endl;
+                break;
+            case BidResult::BelowAsk: {
+                lock_guard<mutex> guard(auction->lock);
+                cout << "Bid must be at least the current asking price: $" << auction->getCurrentPrice() << endl;
+                break;
+            }
+        }
+    }
+
+    void displayActiveAuctions() const {
+        cout << "\n=== Active Auctions ===" << endl;
+        bool hasActive = false;
+
+        // Start the walk at `now`: anything earlier has expired and is only
+        // waiting for the expiry wheel to settle it.
+        auto now = engineNow();
+        EndCursor cursor(now, NO_ID);
+        for (auto page = endingSoonest(50, &cursor); !page.empty(); page = endingSoonest(50, &cursor)) {
+            for (const auto& entry : page) {
+                const Auction& auction = *auctions.find(entry.second);
+                typename Auction::View view = auction.getView();
+                if (!view.active)
+                    continue;
+
+                hasActive = true;
+                const auto& item = auction.getItem();
+                cout << "ID: " << ids.name(item.id) << " | " << item.name
+                     << " | Current Price: $" << view.price
+                     << " | Time Left: " << duration_cast<seconds>(item.endTime - now).count() << "s" << endl;
+            }
+            cursor = page.back();
+        }
+
+        if (!hasActive)
+            cout << "No active auctions available." << endl;
+    }
+
+    void displayAuctionDetails(const string& itemId) const {
+        const Auction* auction = auctions.find(ids.find(itemId));
+        if (!auction) {
+            cout << "Auction not found!" << endl;
+            return;
+        }
+
+        AuctionSummary summary;
+        summarize(*auction, engineNow(), summary);
+        const Item& item = auction->getItem();
+        cout << "\n=== Auction Details ===" << endl;
+        cout << "Item: " << item.name << " (ID: " << ids.name(item.id) << ")" << endl;
+        cout << "Description: " << item.description << endl;
+        cout << "Starting Price: $" << item.startingPrice << endl;
+        cout << "Reserve Price: $" << item.reservePrice << endl;
+        cout << "Current Price: $" << summary.price << endl;
+        cout << "Seller: " << ids.name(item.sellerId) << endl;
+        cout << "Status: " << (summary.active ? "Active" : "Ended") << endl;
+        cout << "Time Remaining: " << summary.remainingSeconds << " seconds" << endl;
+        cout << "Reserve Met: " << (summary.reserveMet ? "Yes" : "No") << endl;
+        cout << "Total Bids: " << summary.bidCount << endl;
+
+        if (summary.leader != NO_ID) {
+            cout << "Highest Bidder: " << ids.name(summary.leader) << endl;
+        }
+    }
+
+    void displayUserProfile(SessionId session) const {
+        Id userId = sessionUser(session);
+        if (userId == NO_ID) {
+            cout << "Please login first!" << endl;
+            return;
+        }
+
+        const User& user = *users.find(userId);
+        lock_guard<mutex> guard(user.lock);
+        cout << "\n=== User Profile ===" << endl;
+        cout << "Username: " << user.username << endl;
+        cout << "Email: " << user.email << endl;
+        cout << "Balance: $" << user.balance << endl;
+        cout << "Bids Placed: " << user.bidHistory.count() << endl;
+        cout << "Items Owned: " << user.ownedItems.count() << endl;
+        cout << "Items Sold: " << user.soldItems.count() << endl;
+
+        userAuctions.forKey(userId, [](const vector<Id>& items) {
+            cout << "Auctions Created: " << items.size() << endl;
+        });
+    }
+
+    void displayMenu() const {
+        cout << "\n=== Auction Menu ===\n";
+        cout << "1. Register User\n2. Login\n3. Logout\n4. Create Auction\n5. Place Bid\n";
+        cout << "6. View Active Auctions\n7. View Auction Details\n8. View User Profile\n";
+        cout << "9. End Auction\n10. Add Balance\n0. Exit\nChoice: ";
+    }
+
+public:
+    void run() {
+        int choice;
+        string username, email, itemName, description, itemId;
+        double startPrice, reservePrice, amount;
+        int duration;
+        Id id;
+        SessionId session = NO_SESSION, next;
+
+        ConsoleSink console(ids, sink);
+        EventSink* previousSink = sink;
+        sink = &console;
+
+        cout << "Welcome to the Auction System!" << endl;
+
+        while (true) {
+            expireAuctions(engineNow());
+            maybeCheckpoint();
+            displayMenu();
+            cin >> choice;
+            cin.ignore();
+
+            switch (choice) {
+                case 1:
+                    cout << "Username: "; getline(cin, username);
+                    cout << "Email: "; getline(cin, email);
+                    id = registerUser(username, email);
+                    if (id == NO_ID)
+                        cout << "Username already exists!" << endl;
+                    else
+                        cout << "User registered successfully! User ID: " << ids.name(id) << endl;
+                    break;
+                case 2:
+                    cout << "Username: "; getline(cin, username);
+                    next = login(username);
+                    if (next != NO_SESSION) {
+                        logout(session); // only once the new login holds
+                        session = next;
+                        cout << "Login successful! Welcome " << username << endl;
+                    } else {
+                        cout << "User not found!" << endl;
+                    }
+                    break;
+                case 3:
+                    logout(session);
+                    session = NO_SESSION;
+                    cout << "Logged out successfully!" << endl;
+                    break;
+                case 4:
+                    cout << "Item Name: "; getline(cin, itemName);
+                    cout << "Description: "; getline(cin, description);
+                    cout << "Start Price: $"; cin >> startPrice;
+                    cout << "Reserve Price: $"; cin >> reservePrice;
+                    cout << "Duration (minutes): "; cin >> duration;
+                    cin.ignore();
+                    id = createAuction(session, itemName, description, Money::fromDouble(startPrice),
+                                       Money::fromDouble(reservePrice), duration);
+                    if (id == NO_ID)
+                        cout << "Please login first!" << endl;
+                    else
+                        cout << "Auction created successfully! Item ID: " << ids.name(id) << endl;
+                    break;
+                case 5:
+                    cout << "Item ID: "; getline(cin, itemId);
+                    cout << "Bid Amount: $"; cin >> amount;
+                    cin.ignore();
+                    printBidResult(sessionUser(session), ids.find(itemId), Money::fromDouble(amount),
+                                   placeBid(session, itemId, Money::fromDouble(amount)));
+                    break;
+                case 6:
+                    displayActiveAuctions(); break;
+                case 7:
+                    cout << "Item ID: "; getline(cin, itemId);
+                    displayAuctionDetails(itemId);
+                    break;
+                case 8:
+                    displayUserProfile(session); break;
+                case 9:
+                    cout << "Item ID: "; getline(cin, itemId);
+                    switch (endAuction(itemId)) {
+                        case SettleResult::AuctionNotFound:
+                            cout << "Auction not found!" << endl; break;
+                        case SettleResult::AlreadyEnded:
+                            cout << "Auction already ended!" << endl; break;
+                        default:
+                            break; // printed by ConsoleSink
+                    }
+                    break;
+                case 10:
+                    cout << "Amount to Add: $"; cin >> amount; cin.ignore();
+                    if (addBalance(session, Money::fromDouble(amount)))
+                        cout << "Balance added successfully! New balance: $" << getBalance(sessionUser(session)) << endl;
+                    else if (sessionUser(session) == NO_ID)
+                        cout << "Please login first!" << endl;
+                    else
+                        cout << "Balance cannot drop below the funds held by your bids!" << endl;
+                    break;
+                case 0:
+                    cout << "Goodbye!" << endl;
+                    logout(session);
+                    sink = previousSink;
+                    return;
+                default:
+                    cout << "Invalid choice." << endl;
+            }
+        }
+    }
+};
+
+typedef BasicAuctionSystem<EnglishAuction> AuctionSystem;
+typedef BasicAuctionSystem<DutchAuction> DutchAuctionSystem;
+typedef BasicAuctionSystem<VickreyAuction> VickreyAuctionSystem;
+
+// -------------------- Sharded Engine --------------------
+// Multi-core alternative to AuctionSystem. Auctions are partitioned by item id
+// hash and accounts by user id hash; each shard owns its partition outright
+// and runs it on a dedicated thread, so no shard state is ever locked.
+//
+// Shards talk only through SPSC queues: every shard has one inbox per peer
+// shard and one per client port (a port must only be used by one client
+// thread). A bid travels:
+//
+//   client -> user's home shard  hold amount against balance - held
+//          -> item's shard       tryBid, publish the result
+//          -> a home shard       release the bidder's hold if rejected, or
+//                                the outbid leader's hold if accepted
+//
+// so, as with AuctionSystem's escrow, only the leader of an auction holds
+// funds for it and a user cannot commit more than their balance across
+// shards. Settlement sends Capture to the winner's home shard, which charges
+// the held amount and sends Credit to the seller's home shard.
+//
+// A Create goes straight to the item's shard, so it can land after a bid
+// posted later on the same port. Each bid carries how many Creates its port
+// had sent to that shard by then; the item's shard parks a bid for an unknown
+// item until it has handled that many, and only then reports AuctionNotFound.
+struct ShardMessage {
+    enum Kind : uint8_t { Open, Deposit, Create, Bid, Reserved, Release, Settle, Capture, Credit };
+
+    Kind kind;
+    Id itemId;
+    Id userId;
+    Id sellerId;
+    Money amount;
+    time_point<steady_clock> timestamp;
+    Item* item; // Create only; the receiving shard takes ownership
+    uint32_t port = 0;          // Create, Bid, Reserved: the client port posted on
+    uint64_t createsBefore = 0; // Bid, Reserved: Creates the port had sent the item's shard
+};
+
+class ShardedEngine {
+private:
+    static const size_t QUEUE_SIZE = 1 << 12;
+    typedef SpscQueue<ShardMessage, QUEUE_SIZE> Queue;
+
+    struct Account {
+        Money balance;
+        Money held; // escrowed by bids in flight or currently leading
+    };
+
+    struct Shard {
+        unordered_map<Id, Auction> auctions;
+        unordered_map<Id, Account> accounts;
+        ExpiryWheel expiry;
+        vector<unique_ptr<Queue>> inbox;            // [peer shards..., client ports...]
+        vector<vector<ShardMessage>> overflow;      // per target shard, when its inbox is full
+        vector<uint64_t> created;                   // per client port, Creates handled
+        vector<vector<ShardMessage>> early;         // per client port, bids parked for a Create
+        thread worker;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    size_t portCount;
+    vector<vector<uint64_t>> createsPosted; // [port][shard]; each row owned by its port's thread
+    atomic<int64_t> inFlight{ 0 };
+    atomic<bool> stopping{ false };
+    NoopSink noopSink;
+    EventSink* sink = &noopSink;
+
+    size_t shardOf(Id id) const {
+        return (size_t)((uint64_t(id) * 0x9E3779B97F4A7C15ull) >> 32) % shards.size();
+    }
+
+    // Client side: spins while the port's inbox is full.
+    void post(size_t port, size_t target, const ShardMessage& message) {
+        inFlight.fetch_add(1, memory_order_relaxed);
+        Queue& queue = *shards[target]->inbox[shards.size() + port];
+        while (!queue.push(message))
+            this_thread::yield();
+    }
+
+    // Shard side: never blocks, so two shards with full inboxes cannot wait
+    // on each other; what does not fit is retried from the overflow list.
+    void relay(size_t from, size_t target, const ShardMessage& message) {
+        inFlight.fetch_add(1, memory_order_relaxed);
+        Shard& shard = *shards[from];
+        if (!shard.overflow[target].empty() || !shards[target]->inbox[from]->push(message))
+            shard.overflow[target].push_back(message);
+    }
+
+    void flushOverflow(size_t from) {
+        Shard& shard = *shards[from];
+        for (size_t target = 0; target < shards.size(); target++) {
+            auto& pending = shard.overflow[target];
+            size_t sent = 0;
+            while (sent < pending.size() && shards[target]->inbox[from]->push(pending[sent]))
+                sent++;
+            pending.erase(pending.begin(), pending.begin() + sent);
+        }
+    }
+
+    void publishBid(const ShardMessage& message, BidResult result) {
+        EventType type = result == BidResult::Accepted ? EventType::BidAccepted : EventType::BidRejected;
+        sink->publish({ type, result, SettleResult::Sold, message.itemId, message.userId, message.amount });
+    }
+
+    void settle(size_t index, Id itemId) {
+        Shard& shard = *shards[index];
+        auto it = shard.auctions.find(itemId);
+        if (it == shard.auctions.end() || !it->second.getItem().isActive)
+            return;
+
+        Auction& auction = it->second;
+        auction.endAuction();
+        const Bid& highest = auction.getHighestBid();
+        SettleResult result = highest.userId == NO_ID       ? SettleResult::NoBids
+                              : !auction.hasReserveBeenMet() ? SettleResult::ReserveNotMet
+                                                             : SettleResult::Sold;
+        Id winner = result == SettleResult::Sold ? highest.userId : NO_ID;
+        if (winner != NO_ID)
+            relay(index, shardOf(winner),
+                  { ShardMessage::Capture, itemId, winner, auction.getItem().sellerId, highest.amount, {}, nullptr });
+        else if (highest.userId != NO_ID)
+            relay(index, shardOf(highest.userId),
+                  { ShardMessage::Release, itemId, highest.userId, NO_ID, highest.amount, {}, nullptr });
+        sink->publish({ EventType::AuctionSettled, BidResult::Accepted, result, itemId, winner, highest.amount });
+    }
+
+    void handle(size_t index, const ShardMessage& message, time_point<steady_clock> now) {
+        Shard& shard = *shards[index];
+        switch (message.kind) {
+            case ShardMessage::Open:
+                shard.accounts[message.userId].balance = message.amount;
+                break;
+            case ShardMessage::Deposit:
+            case ShardMessage::Credit: {
+                auto it = shard.accounts.find(message.userId);
+                if (it != shard.accounts.end())
+                    it->second.balance += message.amount;
+                break;
+            }
+            case ShardMessage::Create: {
+                unique_ptr<Item> item(message.item);
+                Id itemId = item->id;
+                auto end = item->endTime;
+                if (shard.auctions.emplace(piecewise_construct, forward_as_tuple(itemId), forward_as_tuple(move(*item))).second)
+                    shard.expiry.schedule(itemId, end);
+                shard.created[message.port]++;
+                if (!shard.early[message.port].empty())
+                    retryEarly(index, message.port, now);
+                break;
+            }
+            case ShardMessage::Bid: {
+                auto it = shard.accounts.find(message.userId);
+                if (it == shard.accounts.end()) {
+                    publishBid(message, BidResult::NotLoggedIn);
+                } else if (it->second.balance - it->second.held < message.amount) {
+                    publishBid(message, BidResult::InsufficientBalance);
+                } else {
+                    it->second.held += message.amount;
+                    ShardMessage reserved = message;
+                    reserved.kind = ShardMessage::Reserved;
+                    relay(index, shardOf(message.itemId), reserved);
+                }
+                break;
+            }
+            case ShardMessage::Reserved: {
+                auto it = shard.auctions.find(message.itemId);
+                if (it == shard.auctions.end() && shard.created[message.port] < message.createsBefore) {
+                    inFlight.fetch_add(1, memory_order_relaxed); // still owed a result
+                    shard.early[message.port].push_back(message);
+                    break;
+                }
+                Bid previous;
+                BidResult result = BidResult::AuctionNotFound;
+                if (it != shard.auctions.end()) {
+                    previous = it->second.getHighestBid();
+                    result = it->second.tryBid(message.userId, message.amount, message.timestamp, now);
+                }
+                publishBid(message, result);
+                ShardMessage release = message;
+                release.kind = ShardMessage::Release;
+                if (result == BidResult::Accepted) {
+                    release.userId = previous.userId;
+                    release.amount = previous.amount;
+                }
+                if (release.userId != NO_ID)
+                    relay(index, shardOf(release.userId), release);
+                break;
+            }
+            case ShardMessage::Release:
+                shard.accounts[message.userId].held -= message.amount;
+                break;
+            case ShardMessage::Settle:
+                settle(index, message.itemId);
+                break;
+            case ShardMessage::Capture: {
+                Account& buyer = shard.accounts[message.userId];
+                buyer.held -= message.amount;
+                buyer.balance -= message.amount;
+                relay(index, shardOf(message.sellerId),
+                      { ShardMessage::Credit, message.itemId, message.sellerId, NO_ID, message.amount, {}, nullptr });
+                break;
+            }
+        }
+    }
+
+    // Answers the port's parked bids whose Creates have all been handled.
+    void retryEarly(size_t index, uint32_t port, time_point<steady_clock> now) {
+        Shard& shard = *shards[index];
+        vector<ShardMessage> parked;
+        parked.swap(shard.early[port]);
+        for (const ShardMessage& message : parked) {
+            if (shard.created[port] < message.createsBefore) {
+                shard.early[port].push_back(message);
+                continue;
+            }
+            handle(index, message, now);
+            inFlight.fetch_sub(1, memory_order_release);
+        }
+    }
+
+    void run(size_t index) {
+        Shard& shard = *shards[index];
+        vector<Id> due;
+        ShardMessage message;
+        int idle = 0;
+        while (!stopping.load(memory_order_acquire)) {
+            auto now = engineNow();
+            bool worked = false;
+            for (auto& queue : shard.inbox) {
+                // Bounded per queue so one busy producer cannot starve the rest.
+                for (int n = 0; n < 256 && queue->pop(message); n++) {
+                    handle(index, message, now);
+                    inFlight.fetch_sub(1, memory_order_release);
+                    worked = true;
+                }
+            }
+
+            due.clear();
+            shard.expiry.advance(now, due);
+            for (Id itemId : due)
+                settle(index, itemId);
+            flushOverflow(index);
 
-    // Parameterized constructor
-    Item(const string& itemId, const string& itemName, const string& desc,
-         double startPrice, double reserve, const string& seller, int durationMinutes)
-        : id(itemId), name(itemName), description(desc), startingPrice(startPrice),
-          reservePrice(reserve), sellerId(seller), isActive(true) {
-        startTime = steady_clock::now();
-        endTime = startTime + minutes(durationMinutes);
+            if (worked || !due.empty())
+                idle = 0;
+            else if (++idle < 64)
+                this_thread::yield();
+            else
+                this_thread::sleep_for(microseconds(50));
+        }
     }
 
-    bool isExpired() const {
-        return steady_clock::now() > endTime;
+public:
+    ShardedEngine(size_t shardCount, size_t ports = 1) : portCount(ports) {
+        shardCount = max<size_t>(1, shardCount);
+        for (size_t i = 0; i < shardCount; i++) {
+            shards.emplace_back(new Shard());
+            for (size_t q = 0; q < shardCount + ports; q++)
+                shards[i]->inbox.emplace_back(new Queue());
+            shards[i]->overflow.resize(shardCount);
+            shards[i]->created.resize(ports);
+            shards[i]->early.resize(ports);
+        }
+        createsPosted.assign(ports, vector<uint64_t>(shardCount));
+        for (size_t i = 0; i < shardCount; i++)
+            shards[i]->worker = thread(&ShardedEngine::run, this, i);
     }
 
-    int getRemainingSeconds() const {
-        auto remaining = duration_cast<seconds>(endTime - steady_clock::now());
-        return max(0, (int)remaining.count());
+    ~ShardedEngine() {
+        stopping.store(true, memory_order_release);
+        for (auto& shard : shards)
+            shard->worker.join();
+        // Undelivered Create messages still own their Item.
+        for (auto& shard : shards) {
+            ShardMessage message;
+            for (auto& queue : shard->inbox)
+                while (queue->pop(message))
+                    if (message.kind == ShardMessage::Create)
+                        delete message.item;
+        }
     }
-};
 
-// -------------------- User --------------------
-class User {
-public:
-    string id;
-    string username;
-    string email;
-    double balance;
-    vector<string> bidHistory;
-    vector<string> ownedItems;
-    vector<string> soldItems;
+    size_t shardCount() const { return shards.size(); }
+    size_t ports() const { return portCount; }
 
-    User() : id(""), username(""), email(""), balance(0.0) {}
+    // The sink is called from every shard thread at once. Install before use.
+    void setEventSink(EventSink* eventSink) {
+        sink = eventSink ? eventSink : &noopSink;
+    }
 
-    User(const string& userId, const string& uname, const string& mail, double bal = 0.0)
-        : id(userId), username(uname), email(mail), balance(bal) {}
+    void openAccount(size_t port, Id userId, Money balance) {
+        post(port, shardOf(userId), { ShardMessage::Open, NO_ID, userId, NO_ID, balance, {}, nullptr });
+    }
 
-    bool canBid(double amount) const {
-        return balance >= amount;
+    void deposit(size_t port, Id userId, Money amount) {
+        post(port, shardOf(userId), { ShardMessage::Deposit, NO_ID, userId, NO_ID, amount, {}, nullptr });
     }
 
-    void deductBalance(double amount) {
-        if (balance >= amount)
-            balance -= amount;
+    // The caller assigns item.id; a duplicate id is ignored.
+    void createAuction(size_t port, Item item) {
+        Id itemId = item.id;
+        size_t target = shardOf(itemId);
+        createsPosted[port][target]++;
+        post(port, target,
+             { ShardMessage::Create, itemId, item.sellerId, NO_ID, Money(), {}, new Item(move(item)), (uint32_t)port });
     }
 
-    void addBalance(double amount) {
-        balance += amount;
+    // Results arrive asynchronously as BidAccepted/BidRejected events.
+    void placeBid(size_t port, const BidRequest& request) {
+        post(port, shardOf(request.userId),
+             { ShardMessage::Bid, request.itemId, request.userId, NO_ID, request.amount, request.timestamp, nullptr,
+               (uint32_t)port, createsPosted[port][shardOf(request.itemId)] });
     }
 
-    void addBidToHistory(const string& itemId) {
-        bidHistory.push_back(itemId);
+    void placeBids(size_t port, const vector<BidRequest>& requests) {
+        for (const BidRequest& request : requests)
+            placeBid(port, request);
     }
 
-    void addOwnedItem(const string& itemId) {
-        ownedItems.push_back(itemId);
+    void endAuction(size_t port, Id itemId) {
+        post(port, shardOf(itemId), { ShardMessage::Settle, itemId, NO_ID, NO_ID, Money(), {}, nullptr });
     }
 
-    void addSoldItem(const string& itemId) {
-        soldItems.push_back(itemId);
+    // Waits until every message posted so far, and everything it triggered,
+    // has been handled.
+    void quiesce() const {
+        while (inFlight.load(memory_order_acquire) != 0)
+            this_thread::yield();
+    }
+
+    // Account reads are only meaningful after quiesce() with no clients posting.
+    Money getBalance(Id userId) const {
+        const auto& accounts = shards[shardOf(userId)]->accounts;
+        auto it = accounts.find(userId);
+        return it == accounts.end() ? Money() : it->second.balance;
+    }
+
+    Money getHeld(Id userId) const {
+        const auto& accounts = shards[shardOf(userId)]->accounts;
+        auto it = accounts.find(userId);
+        return it == accounts.end() ? Money() : it->second.held;
     }
 };
 
-// -------------------- Auction --------------------
-class Auction {
+// -------------------- Gateway --------------------
+// Binary TCP front end for AuctionSystem, driven by one epoll loop. All
+// integers are little-endian; strings are a uint32 length plus bytes.
+//
+//   request:  [uint32 length][uint8 op][uint32 tag][body]
+//   response: [uint32 length][uint8 op][uint32 tag][uint8 status][body]
+//
+// `length` counts the bytes after itself. The tag is echoed back so clients
+// can pipeline; responses on one connection come back in request order.
+//
+//   Register  str username, str email              -> status 0|1, u32 userId
+//   Login     str username                         -> status 0|1, u32 userId
+//   Bid       u32 itemId, f64 amount               -> status BidResult
+//   Query     u32 itemId                           -> status 0|1, f64 price,
+//                                                     u32 bids, u8 active, i32 secondsLeft
+//   Watch     u32 itemId                           -> status 0|1
+//   Price     (server push, tag 0)                 <- status 0, u32 itemId, f64 price
+//   Stats     (empty)                              -> status 0, str metrics (Prometheus text)
+//   Proxy     u32 itemId, f64 ceiling              -> status BidResult
+//   Search    str query, u8 SearchRank, u16 limit  -> status 0, u8 truncated, u32 count, count x u32 itemId
+//
+// Registered users start with the default balance; clients cannot choose it.
+// An f64 amount that is not finite, not positive or above
+// Money::MAX_WIRE_AMOUNT is answered with BidResult::InvalidAmount and never
+// reaches the engine.
+//
+// Watched prices are coalesced: a client that reads slowly gets each item's
+// latest price, not every bid.
+//
+// Each connection has its own session; bids are placed as its logged-in user. Every bid read in one loop
+// iteration, across all connections, goes to placeBids() as one batch; a
+// connection's other requests first flush the batch so they observe its bids.
+class Gateway {
+public:
+    enum Op : uint8_t { Register = 1, Login, Bid, Query, Watch, Price, Stats, Proxy, Search };
+
 private:
-    Item item;
-    priority_queue<Bid> bids;
-    unordered_map<string, double> userHighestBids;
-    vector<Bid> bidHistory;
+    static const size_t MAX_FRAME = 1 << 16;
+    static const int MAX_EVENTS = 256;
 
-public:
-    Auction() {}
-    Auction(const Item& itm) : item(itm) {}
+    struct Connection {
+        int fd;
+        SessionId session = NO_SESSION;
+        shared_ptr<PriceSubscription> prices;
+        vector<char> in;
+        vector<char> out;
+        size_t sent = 0;
+        size_t pendingBids = 0;
+        bool writable = true; // false while waiting for EPOLLOUT
+        bool peerClosed = false; // EOF read; close once the responses are out
+        bool closing = false;
 
-    bool isActive() const {
-        return item.isActive && !item.isExpired();
+        explicit Connection(int socket) : fd(socket) {}
+    };
+
+    // A bid waiting for the batch; its status byte is patched in afterwards.
+    struct PendingBid {
+        Connection* connection;
+        size_t statusOffset;
+    };
+
+    AuctionSystem& system;
+    int listenFd = -1;
+    int epollFd = -1;
+    uint16_t boundPort = 0;
+    atomic<bool> stopping{ false };
+    unordered_map<int, unique_ptr<Connection>> connections;
+    unordered_map<int, int> priceFds; // subscription fd -> connection fd
+    vector<BidRequest> batch;
+    vector<PendingBid> batchSlots;
+
+    // Returns the offset of the status byte.
+    static size_t beginResponse(vector<char>& out, uint8_t op, uint32_t tag, uint8_t status) {
+        size_t start = out.size();
+        out.resize(start + 10);
+        uint32_t length = 6;
+        memcpy(&out[start], &length, 4);
+        out[start + 4] = (char)op;
+        memcpy(&out[start + 5], &tag, 4);
+        out[start + 9] = (char)status;
+        return start + 9;
     }
 
-    void endAuction() {
-        item.isActive = false;
+    static void putBytes(vector<char>& out, size_t statusOffset, const char* bytes, size_t size) {
+        out.insert(out.end(), bytes, bytes + size);
+        uint32_t length = (uint32_t)(out.size() - (statusOffset - 5));
+        memcpy(&out[statusOffset - 9], &length, 4);
     }
 
-    bool placeBid(const string& userId, double amount) {
-        if (!isActive()) {
-            cout << "Auction is not active!" << endl;
-            return false;
+    template <typename T>
+    static void putField(vector<char>& out, size_t statusOffset, const T& value) {
+        putBytes(out, statusOffset, reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void watch(Connection& connection, bool wantWrite) {
+        epoll_event event{};
+        // After EOF the socket stays readable; stop listening for it.
+        event.events = (connection.peerClosed ? 0u : uint32_t(EPOLLIN)) | (wantWrite ? uint32_t(EPOLLOUT) : 0u);
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.writable = !wantWrite;
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+            connections[fd].reset(new Connection(fd));
         }
+    }
 
-        if (amount <= item.startingPrice) {
-            cout << "Bid must be higher than starting price: $" << item.startingPrice << endl;
-            return false;
+    void runBatch() {
+        if (batch.empty())
+            return;
+        vector<BidResult> results = system.placeBids(batch);
+        for (size_t i = 0; i < results.size(); i++) {
+            PendingBid& slot = batchSlots[i];
+            slot.connection->out[slot.statusOffset] = (char)results[i];
+            slot.connection->pendingBids = 0;
         }
+        batch.clear();
+        batchSlots.clear();
+    }
 
-        if (!bids.empty() && amount <= bids.top().amount) {
-            cout << "Bid must be higher than current highest bid: $" << bids.top().amount << endl;
-            return false;
+    // Returns false on a malformed request.
+    bool execute(Connection& connection, uint8_t op, uint32_t tag, BinaryReader& body, time_point<steady_clock> now) {
+        vector<char>& out = connection.out;
+        if (op == Bid) {
+            Id itemId = body.get<Id>();
+            double amount = body.get<double>();
+            if (!body.ok())
+                return false;
+            if (!Money::validInput(amount)) {
+                beginResponse(out, op, tag, (uint8_t)BidResult::InvalidAmount);
+                return true;
+            }
+            batch.push_back({ itemId, system.sessionUser(connection.session), Money::fromDouble(amount), now });
+            batchSlots.push_back({ &connection, beginResponse(out, op, tag, 0) });
+            connection.pendingBids++;
+            return true;
         }
 
-        if (userId == item.sellerId) {
-            cout << "Cannot bid on your own item!" << endl;
+        if (connection.pendingBids)
+            runBatch();
+
+        if (op == Register) {
+            string username = body.getString();
+            string email = body.getString();
+            if (!body.ok())
+                return false;
+            Id userId = system.registerUser(username, email);
+            putField(out, beginResponse(out, op, tag, userId == NO_ID), userId);
+        } else if (op == Login) {
+            string username = body.getString();
+            if (!body.ok())
+                return false;
+            SessionId session = system.login(username);
+            if (session != NO_SESSION) {
+                system.logout(connection.session);
+                connection.session = session;
+            }
+            Id userId = system.sessionUser(session);
+            putField(out, beginResponse(out, op, tag, userId == NO_ID), userId);
+        } else if (op == Query) {
+            Id itemId = body.get<Id>();
+            if (!body.ok())
+                return false;
+            AuctionSummary summary{};
+            size_t status = beginResponse(out, op, tag, !system.getSummary(itemId, summary));
+            putField(out, status, summary.price.toDouble());
+            putField(out, status, summary.bidCount);
+            putField(out, status, (uint8_t)summary.active);
+            putField(out, status, (int32_t)summary.remainingSeconds);
+        } else if (op == Watch) {
+            Id itemId = body.get<Id>();
+            if (!body.ok())
+                return false;
+            if (!connection.prices) {
+                connection.prices = system.subscribePrices();
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.fd = connection.prices->fd();
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, event.data.fd, &event);
+                priceFds[event.data.fd] = connection.fd;
+            }
+            beginResponse(out, op, tag, !system.watchPrice(connection.prices, itemId));
+        } else if (op == Proxy) {
+            Id itemId = body.get<Id>();
+            double ceiling = body.get<double>();
+            if (!body.ok())
+                return false;
+            if (!Money::validInput(ceiling)) {
+                beginResponse(out, op, tag, (uint8_t)BidResult::InvalidAmount);
+                return true;
+            }
+            BidResult result = system.placeProxyBidAs(system.sessionUser(connection.session), itemId,
+                                                      Money::fromDouble(ceiling));
+            beginResponse(out, op, tag, (uint8_t)result);
+        } else if (op == Search) {
+            string query = body.getString();
+            SearchRank rank = body.get<SearchRank>();
+            uint16_t limit = body.get<uint16_t>();
+            if (!body.ok())
+                return false;
+            bool truncated = false;
+            vector<Id> found = system.search(query, rank, limit, &truncated);
+            size_t status = beginResponse(out, op, tag, 0);
+            putField(out, status, (uint8_t)truncated);
+            putField(out, status, (uint32_t)found.size());
+            putBytes(out, status, reinterpret_cast<const char*>(found.data()), found.size() * sizeof(Id));
+        } else if (op == Stats) {
+            string text = system.prometheusStats();
+            size_t status = beginResponse(out, op, tag, 0);
+            putField(out, status, (uint32_t)text.size());
+            putBytes(out, status, text.data(), text.size());
+        } else {
             return false;
         }
+        return true;
+    }
 
-        Bid newBid(userId, amount, item.id);
-        bids.push(newBid);
-        bidHistory.push_back(newBid);
-        userHighestBids[userId] = max(userHighestBids[userId], amount);
+    void drainPrices(Connection& connection) {
+        PriceUpdate update;
+        while (connection.prices->next(update)) {
+            size_t status = beginResponse(connection.out, Price, 0, 0);
+            putField(connection.out, status, update.itemId);
+            putField(connection.out, status, update.price.toDouble());
+        }
+    }
 
-        cout << "Bid placed successfully! Current highest bid: $" << amount << endl;
-        return true;
+    void readAll(Connection& connection, time_point<steady_clock> now) {
+        char chunk[1 << 16];
+        while (true) {
+            ssize_t got = ::read(connection.fd, chunk, sizeof(chunk));
+            if (got > 0) {
+                connection.in.insert(connection.in.end(), chunk, chunk + got);
+                continue;
+            }
+            if (got == 0) {
+                // Half-close: the frames already received are still answered.
+                connection.peerClosed = true;
+                watch(connection, !connection.writable);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.closing = true;
+            }
+            break;
+        }
+
+        size_t pos = 0;
+        vector<char>& in = connection.in;
+        while (!connection.closing && in.size() - pos >= 4) {
+            uint32_t length;
+            memcpy(&length, &in[pos], 4);
+            if (length < 5 || length > MAX_FRAME) {
+                connection.closing = true;
+                break;
+            }
+            if (in.size() - pos - 4 < length)
+                break;
+            uint8_t op = (uint8_t)in[pos + 4];
+            uint32_t tag;
+            memcpy(&tag, &in[pos + 5], 4);
+            BinaryReader body(&in[pos + 9], length - 5);
+            if (!execute(connection, op, tag, body, now))
+                connection.closing = true;
+            pos += 4 + length;
+        }
+        in.erase(in.begin(), in.begin() + pos);
     }
 
-    Bid getHighestBid() const {
-        if (bids.empty()) return Bid();
-        return bids.top();
+    // A half-closed connection is done once its responses are sent.
+    static bool finished(const Connection& connection) {
+        return connection.closing || (connection.peerClosed && connection.out.empty() && !connection.pendingBids);
     }
 
-    double getCurrentPrice() const {
-        if (bids.empty()) return item.startingPrice;
-        return bids.top().amount;
+    void flush(Connection& connection) {
+        while (connection.sent < connection.out.size()) {
+            ssize_t n = send(connection.fd, connection.out.data() + connection.sent,
+                             connection.out.size() - connection.sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                connection.sent += n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (connection.writable)
+                    watch(connection, true);
+                return;
+            }
+            connection.closing = true;
+            return;
+        }
+        connection.out.clear();
+        connection.sent = 0;
+        if (!connection.writable)
+            watch(connection, false);
     }
 
-    const Item& getItem() const {
-        return item;
+    void close(int fd) {
+        Connection& connection = *connections[fd];
+        system.logout(connection.session);
+        if (connection.prices) {
+            int priceFd = connection.prices->fd();
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, priceFd, nullptr);
+            priceFds.erase(priceFd);
+            system.unsubscribePrices(connection.prices);
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
     }
 
-    vector<Bid> getBidHistory() const {
-        return bidHistory;
+public:
+    explicit Gateway(AuctionSystem& auctionSystem) : system(auctionSystem) {}
+
+    ~Gateway() {
+        for (auto& pair : connections)
+            ::close(pair.first);
+        if (epollFd >= 0)
+            ::close(epollFd);
+        if (listenFd >= 0)
+            ::close(listenFd);
     }
 
-    unordered_map<string, double> getUserBids() const {
-        return userHighestBids;
+    // Binds 0.0.0.0:port (0 picks a free port, see port()).
+    bool listen(uint16_t port) {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            return false;
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        socklen_t size = sizeof(address);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), size) != 0 || ::listen(listenFd, 512) != 0 ||
+            getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &size) != 0)
+            return false;
+        boundPort = ntohs(address.sin_port);
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        return epollFd >= 0 && epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == 0;
     }
 
-    bool hasReserveBeenMet() const {
-        return getCurrentPrice() >= item.reservePrice;
+    uint16_t port() const { return boundPort; }
+
+    // Safe to call from another thread or a signal handler.
+    void stop() {
+        stopping.store(true);
     }
 
-    void displayAuctionInfo() const {
-        cout << "\n=== Auction Details ===" << endl;
-        cout << "Item: " << item.name << " (ID: " << item.id << ")" << endl;
-        cout << "Description: " << item.description << endl;
-        cout << "Starting Price: $" << item.startingPrice << endl;
-        cout << "Reserve Price: $" << item.reservePrice << endl;
-        cout << "Current Price: $" << getCurrentPrice() << endl;
-        cout << "Seller: " << item.sellerId << endl;
-        cout << "Status: " << (isActive() ? "Active" : "Ended") << endl;
-        cout << "Time Remaining: " << item.getRemainingSeconds() << " seconds" << endl;
-        cout << "Reserve Met: " << (hasReserveBeenMet() ? "Yes" : "No") << endl;
-        cout << "Total Bids: " << bidHistory.size() << endl;
+    // Serves until stop(); also settles expired auctions and checkpoints.
+    void run() {
+        epoll_event events[MAX_EVENTS];
+        vector<int> touched; // connection fds; a socket and its price feed can both be ready
+        while (!stopping.load()) {
+            int ready = epoll_wait(epollFd, events, MAX_EVENTS, 100);
+            auto now = engineNow();
+            touched.clear();
+            for (int i = 0; i < ready; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                    continue;
+                }
+                auto price = priceFds.find(fd);
+                if (price != priceFds.end())
+                    fd = price->second;
+                auto it = connections.find(fd);
+                if (it == connections.end())
+                    continue;
+                Connection& connection = *it->second;
+                if (price != priceFds.end())
+                    drainPrices(connection);
+                else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    readAll(connection, now);
+                touched.push_back(fd);
+            }
+            runBatch();
 
-        if (!bids.empty()) {
-            cout << "Highest Bidder: " << bids.top().userId << endl;
+            sort(touched.begin(), touched.end());
+            touched.erase(unique(touched.begin(), touched.end()), touched.end());
+            for (int fd : touched) {
+                Connection& connection = *connections[fd];
+                if (!connection.closing && !connection.out.empty())
+                    flush(connection);
+            }
+            for (int fd : touched)
+                if (finished(*connections[fd]))
+                    close(fd);
+
+            system.settleExpired(now);
+            system.maybeCheckpoint();
         }
+        system.sync();
     }
 };
 
-// -------------------- Auction System --------------------
-class AuctionSystem {
+// -------------------- Benchmarks --------------------
+// `auction --bench [key=value ...]` runs a fixed suite against an in-memory
+// AuctionSystem and prints throughput and latency percentiles per operation.
+//
+//   users=100000 auctions=10000 bids=1000000 threads=<cores> zipf=0.99
+//   burst=0.2 (share of bids sent to the closing auctions in their last second)
+//   closing=100 (auctions that close together)
+//
+// Item popularity is Zipfian, as in YCSB: a few auctions attract most bids.
+
+// Gray et al., "Quickly generating billion-record synthetic databases".
+// Ranks are 0-based, 0 the most popular; theta in (0, 1).
+class ZipfGenerator {
 private:
-    unordered_map<string, User> users;
-    unordered_map<string, Auction> auctions;
-    unordered_map<string, vector<string>> userAuctions;
-    string currentUserId;
+    uint64_t n;
+    double theta, alpha, zetan, eta;
+    uniform_real_distribution<double> uniform{ 0.0, 1.0 };
 
-    string generateId() {
-        static int counter = 1000;
-        return "ID" + to_string(counter++);
+    static double zeta(uint64_t count, double theta) {
+        double sum = 0.0;
+        for (uint64_t i = 1; i <= count; i++)
+            sum += 1.0 / pow((double)i, theta);
+        return sum;
     }
 
 public:
-    bool registerUser(const string& username, const string& email, double initialBalance = 1000.0) {
-        for (const auto& pair : users)
-            if (pair.second.username == username) {
-                cout << "Username already exists!" << endl;
-                return false;
-            }
-
-        string userId = generateId();
-        users[userId] = User(userId, username, email, initialBalance);
-        cout << "User registered successfully! User ID: " << userId << endl;
-        return true;
+    ZipfGenerator(uint64_t items, double skew) : n(max<uint64_t>(items, 2)), theta(skew) {
+        alpha = 1.0 / (1.0 - theta);
+        zetan = zeta(n, theta);
+        eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan);
     }
 
-    bool loginUser(const string& username) {
-        for (const auto& pair : users)
-            if (pair.second.username == username) {
-                currentUserId = pair.first;
-                cout << "Login successful! Welcome " << username << endl;
-                return true;
-            }
-        cout << "User not found!" << endl;
-        return false;
+    template <typename Rng>
+    uint64_t next(Rng& rng) {
+        double u = uniform(rng);
+        double uz = u * zetan;
+        if (uz < 1.0)
+            return 0;
+        if (uz < 1.0 + pow(0.5, theta))
+            return 1;
+        return min<uint64_t>(n - 1, (uint64_t)(n * pow(eta * u - eta + 1.0, alpha)));
     }
+};
 
-    void logoutUser() {
-        currentUserId = "";
-        cout << "Logged out successfully!" << endl;
+struct BenchConfig {
+    size_t users = 100000;
+    size_t auctions = 10000;
+    size_t bids = 1000000;
+    size_t threads = max(1u, thread::hardware_concurrency());
+    double zipf = 0.99;
+    double burst = 0.2;
+    size_t closing = 100;
+};
+
+// Synthetic bid stream: a Zipfian steady phase, then the closing-second burst
+// in which `closing` auctions take `burst` of all bids. Amounts climb per item
+// so most bids are accepted; about one in ten is deliberately too low.
+class BidWorkload {
+public:
+    vector<BidRequest> steady;
+    vector<BidRequest> closingBurst;
+    vector<Id> closingItems;
+
+    BidWorkload(const BenchConfig& config, const vector<Id>& users, const vector<Id>& items, uint64_t seed) {
+        mt19937_64 rng(seed);
+        vector<Id> byPopularity(items);
+        shuffle(byPopularity.begin(), byPopularity.end(), rng);
+        ZipfGenerator zipf(items.size(), config.zipf);
+        uniform_int_distribution<size_t> anyUser(0, users.size() - 1);
+        unordered_map<Id, Money> price;
+        auto now = engineNow();
+
+        auto bid = [&](Id itemId) {
+            Money& current = price[itemId];
+            bool low = rng() % 10 == 0;
+            Money amount = low ? current : current + Money::units(1 + (int64_t)(rng() % 100));
+            if (!low)
+                current = amount;
+            return BidRequest{ itemId, users[anyUser(rng)], amount, now };
+        };
+
+        size_t burstBids = (size_t)(config.bids * config.burst);
+        steady.reserve(config.bids - burstBids);
+        for (size_t i = 0; i + burstBids < config.bids; i++)
+            steady.push_back(bid(byPopularity[zipf.next(rng)]));
+
+        closingItems.assign(byPopularity.begin(), byPopularity.begin() + min(config.closing, items.size()));
+        uniform_int_distribution<size_t> anyClosing(0, closingItems.size() - 1);
+        closingBurst.reserve(burstBids);
+        for (size_t i = 0; i < burstBids; i++)
+            closingBurst.push_back(bid(closingItems[anyClosing(rng)]));
     }
+};
 
-    bool createAuction(const string& itemName, const string& description, double startingPrice, double reservePrice, int durationMinutes) {
-        if (currentUserId.empty()) {
-            cout << "Please login first!" << endl;
-            return false;
-        }
+class BenchTimer {
+private:
+    time_point<steady_clock> start = steady_clock::now();
 
-        string itemId = generateId();
-        Item item(itemId, itemName, description, startingPrice, reservePrice, currentUserId, durationMinutes);
-        auctions[itemId] = Auction(item);
-        userAuctions[currentUserId].push_back(itemId);
+public:
+    uint64_t lap() {
+        auto now = steady_clock::now();
+        uint64_t nanos = duration_cast<nanoseconds>(now - start).count();
+        start = now;
+        return nanos;
+    }
+};
 
-        cout << "Auction created successfully! Item ID: " << itemId << endl;
-        return true;
+inline void benchReport(const string& name, uint64_t ops, uint64_t nanos, const LatencyHistogram* latency = nullptr) {
+    double seconds = nanos / 1e9;
+    printf("%-30s %10llu ops %8.3f s %12.0f ops/s", name.c_str(), (unsigned long long)ops, seconds,
+           seconds > 0 ? ops / seconds : 0.0);
+    if (latency && latency->count())
+        printf("  p50 %8.2f  p99 %8.2f  p99.9 %8.2f  max %9.2f us", latency->percentile(0.5) / 1e3,
+               latency->percentile(0.99) / 1e3, latency->percentile(0.999) / 1e3, latency->maximum() / 1e3);
+    printf("\n");
+    fflush(stdout);
+}
+
+// Runs fn(index) for index in [0, count) and records each call's latency.
+template <typename F>
+void benchLoop(const string& name, size_t count, F fn) {
+    LatencyHistogram latency;
+    BenchTimer total, each;
+    for (size_t i = 0; i < count; i++) {
+        fn(i);
+        latency.record(each.lap());
     }
+    benchReport(name, count, total.lap(), &latency);
+}
 
-    bool placeBid(const string& itemId, double amount) {
-        if (currentUserId.empty()) {
-            cout << "Please login first!" << endl;
-            return false;
+inline int runBenchmarks(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        double value = eq == string::npos ? 0.0 : atof(arg.c_str() + eq + 1);
+        if (key == "users") config.users = max<size_t>(1, (size_t)value);
+        else if (key == "auctions") config.auctions = max<size_t>(2, (size_t)value);
+        else if (key == "bids") config.bids = (size_t)value;
+        else if (key == "threads") config.threads = max<size_t>(1, (size_t)value);
+        else if (key == "zipf") config.zipf = min(0.999, max(0.001, value));
+        else if (key == "burst") config.burst = min(1.0, max(0.0, value));
+        else if (key == "closing") config.closing = max<size_t>(1, (size_t)value);
+        else {
+            cerr << "Unknown benchmark option " << arg << endl;
+            return 1;
         }
+    }
+    printf("users=%zu auctions=%zu bids=%zu threads=%zu zipf=%.3f burst=%.2f closing=%zu\n", config.users,
+           config.auctions, config.bids, config.threads, config.zipf, config.burst, config.closing);
 
-        if (auctions.find(itemId) == auctions.end()) {
-            cout << "Auction not found!" << endl;
-            return false;
-        }
+    {
+        AuctionSystem bulk;
+        vector<UserRegistration> batch;
+        batch.reserve(config.users);
+        for (size_t i = 0; i < config.users; i++)
+            batch.push_back({ "bulk" + to_string(i), "bulk@example.com", Money::units(1000000000000) });
+        BenchTimer timer;
+        bulk.registerUsers(batch);
+        benchReport("registerUsers (bulk)", config.users, timer.lap());
+    }
 
-        if (!users[currentUserId].canBid(amount)) {
-            cout << "Insufficient balance! Your balance: $" << users[currentUserId].balance << endl;
-            return false;
-        }
+    AuctionSystem system;
+    vector<Id> users(config.users);
+    benchLoop("registerUser", config.users, [&](size_t i) {
+        users[i] = system.registerUser("user" + to_string(i), "user@example.com", Money::units(1000000000000));
+    });
 
-        if (auctions[itemId].placeBid(currentUserId, amount)) {
-            users[currentUserId].addBidToHistory(itemId);
-            return true;
+    vector<string> names(config.users);
+    for (size_t i = 0; i < config.users; i++)
+        names[i] = "user" + to_string(i);
+    vector<SessionId> sessions(config.users);
+    benchLoop("login", config.users, [&](size_t i) { sessions[i] = system.login(names[i]); });
+    benchLoop("logout", config.users, [&](size_t i) { system.logout(sessions[i]); });
+    for (size_t i = 0; i < config.users; i++)
+        sessions[i] = system.login(names[i]);
+
+    vector<Id> items(config.auctions);
+    benchLoop("createAuction", config.auctions, [&](size_t i) {
+        items[i] = system.createAuction(sessions[i % config.users], "item" + to_string(i), "benchmark item", Money::units(1), Money(), 60);
+    });
+
+    BidWorkload workload(config, users, items, 42);
+    const vector<BidRequest>& bids = workload.steady;
+    size_t third = bids.size() / 3;
+
+    benchLoop("placeBidAs (1 thread)", third, [&](size_t i) {
+        system.placeBidAs(bids[i].userId, bids[i].itemId, bids[i].amount);
+    });
+
+    {
+        vector<LatencyHistogram> latencies(config.threads);
+        vector<thread> workers;
+        size_t share = third / config.threads;
+        BenchTimer timer;
+        for (size_t t = 0; t < config.threads; t++) {
+            workers.emplace_back([&, t] {
+                BenchTimer each;
+                for (size_t i = third + t * share, end = i + share; i < end; i++) {
+                    system.placeBidAs(bids[i].userId, bids[i].itemId, bids[i].amount);
+                    latencies[t].record(each.lap());
+                }
+            });
         }
-        return false;
+        for (auto& worker : workers)
+            worker.join();
+        uint64_t nanos = timer.lap();
+        for (size_t t = 1; t < config.threads; t++)
+            latencies[0].merge(latencies[t]);
+        benchReport("placeBidAs (" + to_string(config.threads) + " threads)", share * config.threads, nanos,
+                    &latencies[0]);
     }
 
-    void displayActiveAuctions() const {
-        cout << "\n=== Active Auctions ===" << endl;
-        bool hasActive = false;
+    const size_t BATCH = 256;
+    auto runBatches = [&](const string& name, const vector<BidRequest>& source, size_t begin, size_t end) {
+        LatencyHistogram latency;
+        vector<BidRequest> batch;
+        BenchTimer total, each;
+        for (size_t i = begin; i < end; i += BATCH) {
+            batch.assign(source.begin() + i, source.begin() + min(end, i + BATCH));
+            system.placeBids(batch);
+            latency.record(each.lap());
+        }
+        printf("%s: latency is per batch of %zu\n", name.c_str(), BATCH);
+        benchReport(name, end - begin, total.lap(), &latency);
+    };
+    runBatches("placeBids (batched)", bids, 2 * third, bids.size());
+    runBatches("placeBids (closing burst)", workload.closingBurst, 0, workload.closingBurst.size());
 
-        for (const auto& pair : auctions) {
-            if (pair.second.isActive()) {
-                hasActive = true;
-                const auto& item = pair.second.getItem();
-                cout << "ID: " << item.id << " | " << item.name
-                     << " | Current Price: $" << pair.second.getCurrentPrice()
-                     << " | Time Left: " << item.getRemainingSeconds() << "s" << endl;
+    // The rows above run different slices of the workload against a system
+    // that keeps changing. These pairs apply the same bids to two identical
+    // fresh systems, so the ratio is the batching gain alone: once headless,
+    // once journaling to a scratch directory and syncing at the end.
+    for (bool journaled : { false, true }) {
+        vector<string> scratch;
+        auto replica = [&] {
+            unique_ptr<AuctionSystem> copy(new AuctionSystem());
+            if (journaled) {
+                char directory[] = "/tmp/auction-bench.XXXXXX";
+                if (mkdtemp(directory))
+                    scratch.push_back(directory);
+                if (scratch.empty() || !copy->open(scratch.back()))
+                    cerr << "Could not journal the replica; timing it headless" << endl;
             }
+            for (size_t i = 0; i < config.users; i++)
+                copy->registerUser(names[i], "user@example.com", Money::units(1000000000000));
+            for (size_t i = 0; i < config.auctions; i++)
+                copy->createAuctionAs(users[i % config.users], "item" + to_string(i), "benchmark item",
+                                      Money::units(1), Money(), 60);
+            copy->sync();
+            return copy;
+        };
+        unique_ptr<AuctionSystem> single = replica();
+        unique_ptr<AuctionSystem> batched = replica();
+        const char* mode = journaled ? "journaled" : "headless";
+        vector<BidRequest> batch;
+        BenchTimer timer;
+        for (size_t i = 0; i < third; i++)
+            single->placeBidAs(bids[i].userId, bids[i].itemId, bids[i].amount);
+        single->sync();
+        uint64_t singleNanos = timer.lap();
+        for (size_t i = 0; i < third; i += BATCH) {
+            batch.assign(bids.begin() + i, bids.begin() + min(third, i + BATCH));
+            batched->placeBids(batch);
         }
-
-        if (!hasActive)
-            cout << "No active auctions available." << endl;
+        batched->sync();
+        uint64_t batchedNanos = timer.lap();
+        benchReport(string("placeBidAs (same bids, ") + mode + ")", third, singleNanos);
+        benchReport(string("placeBids (same bids, ") + mode + ")", third, batchedNanos);
+        printf("batched speedup over %s placeBidAs: %.2fx (same %s)\n", mode,
+               batchedNanos ? (double)singleNanos / batchedNanos : 0.0,
+               single->stateChecksum() == batched->stateChecksum() ? "end state" : "bids, DIFFERENT end state");
+        single.reset();
+        batched.reset();
+        for (const string& directory : scratch)
+            ::system(("rm -rf " + directory).c_str());
     }
 
-    void displayAuctionDetails(const string& itemId) {
-        if (auctions.find(itemId) == auctions.end()) {
-            cout << "Auction not found!" << endl;
-            return;
-        }
-        auctions.at(itemId).displayAuctionInfo();
-    }
+    const size_t SCANS = 20;
+    size_t listed = 0;
+    benchLoop("endingSoonest walk", SCANS, [&](size_t) {
+        listed = 0;
+        for (auto page = system.endingSoonest(50); !page.empty(); page = system.endingSoonest(50, &page.back()))
+            listed += page.size();
+    });
+    benchLoop("activeAuctions sweep", SCANS, [&](size_t) { listed = system.activeAuctions(engineNow()).size(); });
+    printf("(%zu auctions listed per scan)\n", listed);
 
-    void displayUserProfile() const {
-        if (currentUserId.empty()) {
-            cout << "Please login first!" << endl;
-            return;
-        }
+    benchLoop("endAuction", items.size(), [&](size_t i) { system.endAuction(items[i]); });
+    return 0;
+}
 
-        const User& user = users.at(currentUserId);
-        cout << "\n=== User Profile ===" << endl;
-        cout << "Username: " << user.username << endl;
-        cout << "Email: " << user.email << endl;
-        cout << "Balance: $" << user.balance << endl;
-        cout << "Bids Placed: " << user.bidHistory.size() << endl;
-        cout << "Items Owned: " << user.ownedItems.size() << endl;
-        cout << "Items Sold: " << user.soldItems.size() << endl;
+// -------------------- Replay --------------------
+// `auction --replay <file> [speed=<x>]` feeds a recording (see OpRecorder)
+// to a fresh in-memory AuctionSystem, one operation at a time. The engine
+// clock is frozen to each record's time, so every expiry and time check sees
+// what the recorded run saw whatever the pace: with speed=0 (the default)
+// operations go back to back; speed=10 issues them at ten times the recorded
+// rate. Prints throughput, per-call latency and the final state checksum, to
+// compare between builds.
+class Replayer {
+private:
+    AuctionSystem& system;
+    time_point<steady_clock> base;
+    unordered_map<SessionId, SessionId> sessions; // recorded -> replayed
+    uint64_t idMismatches = 0;
 
-        if (userAuctions.count(currentUserId))
-            cout << "Auctions Created: " << userAuctions.at(currentUserId).size() << endl;
+    void expectId(Id recorded, Id replayed) {
+        if (recorded != replayed)
+            idMismatches++;
     }
 
-    void endAuction(const string& itemId) {
-        if (auctions.find(itemId) == auctions.end()) {
-            cout << "Auction not found!" << endl;
-            return;
-        }
+    time_point<steady_clock> timeAt(BinaryReader& in) {
+        return base + nanoseconds(in.get<int64_t>());
+    }
 
-        Auction& auction = auctions[itemId];
-        if (!auction.isActive()) {
-            cout << "Auction already ended!" << endl;
-            return;
-        }
+public:
+    Replayer(AuctionSystem& target, time_point<steady_clock> origin) : system(target), base(origin) {}
 
-        auction.endAuction();
-        Bid highestBid = auction.getHighestBid();
+    // Registrations and auctions that got a different id than when recorded;
+    // nonzero means the replay diverged from the recorded run.
+    uint64_t mismatches() const { return idMismatches; }
 
-        cout << "\n=== Auction Ended ===" << endl;
-        if (highestBid.userId.empty()) {
-            cout << "No bids were placed. Item remains unsold." << endl;
-        } else if (!auction.hasReserveBeenMet()) {
-            cout << "Reserve price not met. Item remains unsold." << endl;
+    // Returns false on a malformed record.
+    bool apply(CapturedOp op, BinaryReader& in) {
+        if (op == CapturedOp::Register) {
+            string username = in.getString();
+            string email = in.getString();
+            Money balance = in.get<Money>();
+            Id recorded = in.get<Id>();
+            if (in.ok())
+                expectId(recorded, system.registerUser(username, email, balance));
+        } else if (op == CapturedOp::Login) {
+            string username = in.getString();
+            SessionId recorded = in.get<SessionId>();
+            if (in.ok()) {
+                SessionId session = system.login(username);
+                if (recorded != NO_SESSION)
+                    sessions[recorded] = session;
+            }
+        } else if (op == CapturedOp::Logout) {
+            SessionId recorded = in.get<SessionId>();
+            auto it = sessions.find(recorded);
+            if (in.ok() && it != sessions.end()) {
+                system.logout(it->second);
+                sessions.erase(it);
+            }
+        } else if (op == CapturedOp::CreateAuction) {
+            Id sellerId = in.get<Id>();
+            string name = in.getString();
+            string description = in.getString();
+            Money startingPrice = in.get<Money>();
+            Money reservePrice = in.get<Money>();
+            int durationMinutes = in.get<int>();
+            Id recorded = in.get<Id>();
+            if (in.ok())
+                expectId(recorded,
+                         system.createAuctionAs(sellerId, name, description, startingPrice, reservePrice, durationMinutes));
+        } else if (op == CapturedOp::Bid || op == CapturedOp::ProxyBid) {
+            Id userId = in.get<Id>();
+            Id itemId = in.get<Id>();
+            Money amount = in.get<Money>();
+            if (in.ok() && op == CapturedOp::Bid)
+                system.placeBidAs(userId, itemId, amount);
+            else if (in.ok())
+                system.placeProxyBidAs(userId, itemId, amount);
+        } else if (op == CapturedOp::Bids) {
+            vector<BidRequest> requests(in.get<uint32_t>());
+            for (BidRequest& req : requests) {
+                req.itemId = in.get<Id>();
+                req.userId = in.get<Id>();
+                req.amount = in.get<Money>();
+                req.timestamp = timeAt(in);
+                if (!in.ok())
+                    return false;
+            }
+            system.placeBids(requests);
+        } else if (op == CapturedOp::AddBalance) {
+            Id userId = in.get<Id>();
+            Money amount = in.get<Money>();
+            if (in.ok())
+                system.addBalanceAs(userId, amount);
+        } else if (op == CapturedOp::EndAuction) {
+            Id itemId = in.get<Id>();
+            if (in.ok())
+                system.endAuction(itemId);
+        } else if (op == CapturedOp::ExpireAuctions || op == CapturedOp::SettleExpired) {
+            auto now = timeAt(in);
+            if (in.ok() && op == CapturedOp::ExpireAuctions)
+                system.expireAuctions(now);
+            else if (in.ok())
+                system.settleExpired(now);
         } else {
-            cout << "Item sold to " << highestBid.userId << " for $" << highestBid.amount << endl;
-            users[highestBid.userId].deductBalance(highestBid.amount);
-            users[highestBid.userId].addOwnedItem(itemId);
-            const auto& item = auction.getItem();
-            users[item.sellerId].addBalance(highestBid.amount);
-            users[item.sellerId].addSoldItem(itemId);
+            return false;
         }
+        return in.ok();
     }
+};
 
-    void addBalance(double amount) {
-        if (currentUserId.empty()) {
-            cout << "Please login first!" << endl;
-            return;
+inline int runReplay(int argc, char* argv[]) {
+    if (argc < 1) {
+        cerr << "Usage: auction --replay <file> [speed=<x>]" << endl;
+        return 1;
+    }
+    double speed = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.compare(0, 6, "speed=") == 0) {
+            speed = max(0.0, atof(arg.c_str() + 6));
+        } else {
+            cerr << "Unknown replay option " << arg << endl;
+            return 1;
         }
+    }
 
-        users[currentUserId].addBalance(amount);
-        cout << "Balance added successfully! New balance: $" << users[currentUserId].balance << endl;
+    vector<char> data;
+    if (!readFile(argv[0], data) || data.size() < 8 || memcmp(data.data(), OpRecorder::magic(), 8) != 0) {
+        cerr << "Not a recording: " << argv[0] << endl;
+        return 1;
     }
 
-    void displayMenu() const {
-        cout << "\n=== Auction Menu ===\n";
-        cout << "1. Register User\n2. Login\n3. Logout\n4. Create Auction\n5. Place Bid\n";
-        cout << "6. View Active Auctions\n7. View Auction Details\n8. View User Profile\n";
-        cout << "9. End Auction\n10. Add Balance\n0. Exit\nChoice: ";
+    AuctionSystem system;
+    EngineClock& clock = engineClock();
+    auto base = clock.now();
+    clock.freeze(base);
+    Replayer replayer(system, base);
+
+    uint64_t applied = 0;
+    int64_t logical = 0;
+    BenchTimer timer;
+    auto start = steady_clock::now();
+    size_t pos = 8;
+    while (data.size() - pos >= 4) {
+        uint32_t size;
+        memcpy(&size, data.data() + pos, 4);
+        if (data.size() - pos - 4 < size)
+            break;
+        BinaryReader in(data.data() + pos + 4, size);
+        pos += 4 + size;
+
+        // Records from concurrent callers can be slightly out of time order;
+        // the clock never steps back.
+        logical = max(logical, in.get<int64_t>());
+        CapturedOp op = in.get<CapturedOp>();
+        if (speed > 0)
+            this_thread::sleep_until(start + nanoseconds((int64_t)(logical / speed)));
+        clock.freeze(base + nanoseconds(logical));
+        if (!replayer.apply(op, in)) {
+            cerr << "Malformed record at offset " << pos - 4 - size << endl;
+            break;
+        }
+        applied++;
     }
+    uint64_t elapsed = timer.lap();
+    clock.resume();
 
-    void run() {
-        int choice;
-        string username, email, itemName, description, itemId;
-        double startPrice, reservePrice, amount;
-        int duration;
+    printf("replayed %s: %.3f s of recorded time, speed=%g\n", argv[0], logical / 1e9, speed);
+    benchReport("replay", applied, elapsed);
+    StatsSnapshot stats = system.stats();
+    for (size_t op = 0; op < OP_COUNT; op++) {
+        const LatencyHistogram& latency = stats.latency[op];
+        if (latency.count())
+            benchReport(timedOpName((TimedOp)op), latency.count(), (uint64_t)(latency.mean() * latency.count()),
+                        &latency);
+    }
+    printf("state checksum %08x\n", system.stateChecksum());
+    if (replayer.mismatches())
+        printf("%llu id(s) differ from the recording\n", (unsigned long long)replayer.mismatches());
+    return pos == data.size() && !replayer.mismatches() ? 0 : 1;
+}
 
-        cout << "Welcome to the Auction System!" << endl;
+// -------------------- main --------------------
+static Gateway* activeGateway = nullptr;
 
-        while (true) {
-            displayMenu();
-            cin >> choice;
-            cin.ignore();
+static void stopGateway(int) {
+    if (activeGateway)
+        activeGateway->stop();
+}
 
-            switch (choice) {
-                case 1:
-                    cout << "Username: "; getline(cin, username);
-                    cout << "Email: "; getline(cin, email);
-                    registerUser(username, email);
-                    break;
-                case 2:
-                    cout << "Username: "; getline(cin, username);
-                    loginUser(username);
-                    break;
-                case 3:
-                    logoutUser(); break;
-                case 4:
-                    cout << "Item Name: "; getline(cin, itemName);
-                    cout << "Description: "; getline(cin, description);
-                    cout << "Start Price: $"; cin >> startPrice;
-                    cout << "Reserve Price: $"; cin >> reservePrice;
-                    cout << "Duration (minutes): "; cin >> duration;
-                    cin.ignore();
-                    createAuction(itemName, description, startPrice, reservePrice, duration);
-                    break;
-                case 5:
-                    cout << "Item ID: "; getline(cin, itemId);
-                    cout << "Bid Amount: $"; cin >> amount;
-                    cin.ignore();
-                    placeBid(itemId, amount);
-                    break;
-                case 6:
-                    displayActiveAuctions(); break;
-                case 7:
-                    cout << "Item ID: "; getline(cin, itemId);
-                    displayAuctionDetails(itemId);
-                    break;
-                case 8:
-                    displayUserProfile(); break;
-                case 9:
-                    cout << "Item ID: "; getline(cin, itemId);
-                    endAuction(itemId);
-                    break;
-                case 10:
-                    cout << "Amount to Add: $"; cin >> amount; cin.ignore();
-                    addBalance(amount); break;
-                case 0:
-                    cout << "Goodbye!" << endl; return;
-                default:
-                    cout << "Invalid choice." << endl;
-            }
+// Usage: auction [dataDir]                 interactive console
+//        auction --serve <port> [dataDir]  binary TCP gateway
+//        auction --bench [key=value ...]   benchmark suite
+//        auction --replay <file> [speed=x] replay a recording
+// Either of the first two may be prefixed with --record <file>.
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return runBenchmarks(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--replay") == 0)
+        return runReplay(argc - 2, argv + 2);
+
+    OpRecorder recorder;
+    if (argc > 2 && strcmp(argv[1], "--record") == 0) {
+        if (!recorder.open(argv[2])) {
+            cerr << "Could not create recording " << argv[2] << endl;
+            return 1;
         }
+        argc -= 2;
+        argv += 2;
     }
-};
 
-// -------------------- main --------------------
-int main() {
+    bool serve = argc > 2 && strcmp(argv[1], "--serve") == 0;
+    const char* directory = serve ? (argc > 3 ? argv[3] : nullptr) : (argc > 1 ? argv[1] : nullptr);
+
     AuctionSystem system;
-    system.run();
+    if (directory && !system.open(directory)) {
+        cerr << "Could not open data directory " << directory << endl;
+        return 1;
+    }
+    if (recorder.isOpen())
+        system.setRecorder(&recorder);
+    if (!serve) {
+        system.run();
+        return 0;
+    }
+
+    Gateway gateway(system);
+    if (!gateway.listen((uint16_t)atoi(argv[2]))) {
+        cerr << "Could not listen on port " << argv[2] << endl;
+        return 1;
+    }
+    activeGateway = &gateway;
+    signal(SIGINT, stopGateway);
+    signal(SIGTERM, stopGateway);
+    cerr << "Listening on port " << gateway.port() << endl;
+    gateway.run();
     return 0;
 }
@@ -0,0 +1,77 @@
+// Activity history: the newest User::RECENT entries live in memory, older
+// ones in the activity archive, and userActivity() pages across the two as
+// one newest-first list.
+#include "check.h"
+
+// Collects the whole history in pages of `size`.
+static vector<Id> pages(const AuctionSystem& system, Id userId, Activity kind, size_t size) {
+    vector<Id> all;
+    for (size_t offset = 0;; offset += size) {
+        vector<Id> page = system.userActivity(userId, kind, offset, size);
+        CHECK(page.size() <= size);
+        all.insert(all.end(), page.begin(), page.end());
+        if (page.size() < size)
+            return all;
+    }
+}
+
+// Recovery rebuilds the same list from a checkpoint, or from the journal
+// alone, without archiving the replayed entries a second time.
+static void pagesAcrossArchiveSegments(bool checkpoint) {
+    const string directory = "activity_test.data";
+    ::system(("rm -rf " + directory).c_str());
+    const size_t ITEMS = 3 * User::RECENT + 5; // several archived runs and a partial ring
+    vector<Id> newestFirst;
+    Id bidder;
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        Id seller = system.registerUser("seller", "s@example.com", Money());
+        bidder = system.registerUser("bidder", "b@example.com", Money::units(100000));
+        for (size_t i = 0; i < ITEMS; i++) {
+            Id item = system.createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(1), Money(), 10);
+            CHECK(system.placeBidAs(bidder, item, Money::units(2)) == BidResult::Accepted);
+            if (i % 10 == 0) // a repeat on the same item is counted, not listed again
+                CHECK(system.placeBidAs(bidder, item, Money::units(3)) == BidResult::Accepted);
+            newestFirst.insert(newestFirst.begin(), item);
+        }
+        CHECK(system.activityCount(bidder, Activity::Bid) == ITEMS + (ITEMS + 9) / 10);
+
+        for (size_t size : { (size_t)1, (size_t)7, User::RECENT, User::RECENT + 1, (size_t)1000 })
+            CHECK(pages(system, bidder, Activity::Bid, size) == newestFirst);
+        // A page starting inside the ring and ending in the archive.
+        vector<Id> straddling = system.userActivity(bidder, Activity::Bid, User::RECENT - 3, 10);
+        CHECK(straddling == vector<Id>(newestFirst.begin() + User::RECENT - 3, newestFirst.begin() + User::RECENT + 7));
+        CHECK(system.userActivity(bidder, Activity::Bid, ITEMS, 10).empty());
+        CHECK(system.userActivity(bidder, Activity::Owned, 0, 10).empty());
+        if (checkpoint)
+            CHECK(system.checkpoint());
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    CHECK(pages(recovered, bidder, Activity::Bid, 5) == newestFirst);
+    ::system(("rm -rf " + directory).c_str());
+}
+
+// Without a data directory only the ring is kept, but the count is lifetime.
+static void withoutArchiveOnlyRecentRemain() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100000));
+    vector<Id> newestFirst;
+    for (size_t i = 0; i < User::RECENT + 10; i++) {
+        Id item = system.createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(1), Money(), 10);
+        CHECK(system.placeBidAs(bidder, item, Money::units(2)) == BidResult::Accepted);
+        newestFirst.insert(newestFirst.begin(), item);
+    }
+    newestFirst.resize(User::RECENT);
+    CHECK(pages(system, bidder, Activity::Bid, 6) == newestFirst);
+    CHECK(system.activityCount(bidder, Activity::Bid) == User::RECENT + 10);
+}
+
+int main() {
+    pagesAcrossArchiveSegments(true);
+    pagesAcrossArchiveSegments(false);
+    withoutArchiveOnlyRecentRemain();
+    return finishChecks("activity_test");
+}
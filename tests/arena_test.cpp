@@ -0,0 +1,80 @@
+// Per-auction arenas: releasing a settled auction's history frees its
+// containers at once, keeps the leaderboard, and with an archive attached the
+// engine does so on close while every view still reads the same.
+#include "check.h"
+
+static void releaseKeepsTheLeaderboard() {
+    Auction auction(Item(1, "lamp", "brass", Money::units(1), Money(), 99, 10));
+    auto now = engineNow();
+    for (Id user = 2; user < 40; user++) {
+        auction.setProxy(user, Money::units(1000 + user));
+        auction.acceptBid(user, Money::units(user), now);
+        if (user % 3)
+            auction.dropProxy(user); // churns nodes through the proxy pool
+    }
+    CHECK(auction.getBidCount() == 38 && auction.getUserBids().size() == 38);
+    CHECK(auction.topProxy() && auction.topProxy()->userId == 39);
+    Bid top = auction.getHighestBid();
+
+    auction.endAuction();
+    auction.releaseHistory();
+    CHECK(auction.isReleased());
+    CHECK(auction.getUserBids().empty() && auction.recentBids().count == 0);
+    CHECK(!auction.topProxy());
+    CHECK(auction.getHighestBid().userId == top.userId && auction.getHighestBid().amount == top.amount);
+    CHECK(auction.getLeaders().size() == 8);
+}
+
+template <typename F>
+static void eachView(const AuctionSystem& system, Id item, F check) {
+    unordered_map<Id, Money> highest;
+    system.visitUserBids(item, [&](Id userId, Money amount) { highest[userId] = amount; });
+    vector<Bid> top;
+    system.visitLeaders(item, [&](const Bid& bid) { top.push_back(bid); });
+    size_t history = 0;
+    system.visitBidHistory(item, [&](const BidColumns& run) { history += run.count; });
+    check(highest, top, history);
+}
+
+static void settlingWithAnArchiveReleases(bool archived) {
+    const string directory = "arena_test.data";
+    ::system(("rm -rf " + directory).c_str());
+    AuctionSystem system;
+    if (archived)
+        CHECK(system.open(directory));
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    vector<Id> users;
+    for (int u = 0; u < 5; u++)
+        users.push_back(system.registerUser("user" + to_string(u), "u@example.com", Money::units(1000)));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+    for (int i = 0; i < 200; i++)
+        CHECK(system.placeBidAs(users[i % 5], item, Money::units(2 + i)) == BidResult::Accepted);
+
+    unordered_map<Id, Money> before;
+    vector<Bid> beforeTop;
+    eachView(system, item, [&](const unordered_map<Id, Money>& highest, const vector<Bid>& top, size_t history) {
+        before = highest;
+        beforeTop = top;
+        CHECK(history == 200);
+    });
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    eachView(system, item, [&](const unordered_map<Id, Money>& highest, const vector<Bid>& top, size_t history) {
+        CHECK(highest == before);
+        CHECK(top.size() == beforeTop.size());
+        for (size_t i = 0; i < min(top.size(), beforeTop.size()); i++)
+            CHECK(top[i].userId == beforeTop[i].userId && top[i].amount == beforeTop[i].amount);
+        CHECK(history == 200);
+    });
+    // Only an archived auction can give its window up.
+    size_t window = 0;
+    system.visitBidHistory(item, [&](const BidColumns& run) { window = run.count; });
+    CHECK(archived ? window == 0 : window == 200);
+    ::system(("rm -rf " + directory).c_str());
+}
+
+int main() {
+    releaseKeepsTheLeaderboard();
+    settlingWithAnArchiveReleases(true);
+    settlingWithAnArchiveReleases(false);
+    return finishChecks("arena_test");
+}
@@ -0,0 +1,97 @@
+// Benchmark suite: the workload generator produces the skew and the closing
+// burst it promises, and a tiny run of the whole suite completes with the
+// batched and single-bid replicas ending in the same state.
+#include "check.h"
+
+static void zipfFavoursLowRanks() {
+    const uint64_t ITEMS = 1000;
+    mt19937_64 rng(5);
+    ZipfGenerator zipf(ITEMS, 0.99);
+    vector<size_t> hits(ITEMS);
+    for (int i = 0; i < 200000; i++) {
+        uint64_t rank = zipf.next(rng);
+        CHECK(rank < ITEMS);
+        if (rank < ITEMS)
+            hits[rank]++;
+    }
+    CHECK(hits[0] > hits[1] && hits[1] > hits[10] && hits[10] > hits[500]);
+    size_t head = accumulate(hits.begin(), hits.begin() + 10, (size_t)0);
+    CHECK(head > 200000 / 5); // the top 1% of items draws well over 20% of bids
+}
+
+static void workloadSplitsSteadyAndBurst() {
+    BenchConfig config;
+    config.bids = 10000;
+    config.burst = 0.25;
+    config.closing = 7;
+    vector<Id> users, items;
+    for (Id id = 1; id <= 50; id++)
+        users.push_back(id);
+    for (Id id = 100; id < 300; id++)
+        items.push_back(id);
+    BidWorkload workload(config, users, items, 1);
+
+    CHECK(workload.steady.size() == 7500 && workload.closingBurst.size() == 2500);
+    CHECK(workload.closingItems.size() == 7);
+    for (const BidRequest& bid : workload.closingBurst)
+        CHECK(count(workload.closingItems.begin(), workload.closingItems.end(), bid.itemId) == 1);
+
+    // Per item, amounts never fall, and most bids raise them.
+    unordered_map<Id, Money> last;
+    size_t raises = 0, total = 0;
+    for (const auto* phase : { &workload.steady, &workload.closingBurst })
+        for (const BidRequest& bid : *phase) {
+            CHECK(bid.amount >= last[bid.itemId]);
+            raises += bid.amount > last[bid.itemId];
+            total++;
+            last[bid.itemId] = bid.amount;
+        }
+    CHECK(raises > total * 8 / 10);
+}
+
+// Runs the suite with its output in a file; returns the exit status and the output.
+static int runQuietly(vector<const char*> args, string& output) {
+    const string path = "bench_test.out";
+    fflush(stdout);
+    int saved = dup(1);
+    FILE* file = fopen(path.c_str(), "w");
+    dup2(fileno(file), 1);
+    args.insert(args.begin(), { "auction", "--bench" });
+    int status = auctionMain((int)args.size(), const_cast<char**>(args.data()));
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+    fclose(file);
+    output.clear();
+    if (FILE* in = fopen(path.c_str(), "r")) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            output.append(buffer, n);
+        fclose(in);
+    }
+    remove(path.c_str());
+    return status;
+}
+
+static void tinySuiteRuns() {
+    string output;
+    CHECK(runQuietly({ "users=20", "auctions=10", "bids=3000", "threads=2", "closing=3" }, output) == 0);
+    CHECK(output.find("users=20 auctions=10 bids=3000 threads=2") != string::npos);
+    CHECK(output.find("placeBids (same bids, journaled)") != string::npos);
+    CHECK(output.find("DIFFERENT") == string::npos);
+    CHECK(output.find("endAuction") != string::npos);
+
+    ostringstream errors;
+    streambuf* savedErr = cerr.rdbuf(errors.rdbuf());
+    CHECK(runQuietly({ "usres=20" }, output) == 1);
+    cerr.rdbuf(savedErr);
+    CHECK(errors.str().find("usres=20") != string::npos);
+}
+
+int main() {
+    zipfFavoursLowRanks();
+    workloadSplitsSteadyAndBurst();
+    tinySuiteRuns();
+    return finishChecks("bench_test");
+}
@@ -0,0 +1,29 @@
+// Shared harness for the standalone tests. Each test is one translation unit
+// that includes the whole program with its main() renamed, checks with
+// CHECK (which counts failures instead of aborting) and returns
+// finishChecks() from its own main(). Build and run them all, unoptimised
+// and optimised, with tests/run_tests.sh.
+#pragma once
+
+#define main auctionMain
+#include "../main.cpp"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                           \
+        }                                                                         \
+    } while (0)
+
+// Reports the outcome; the test's exit status.
+static int finishChecks(const char* test) {
+    if (failures)
+        fprintf(stderr, "%s: %d check(s) failed\n", test, failures);
+    else
+        printf("%s: all checks passed\n", test);
+    return failures ? 1 : 0;
+}
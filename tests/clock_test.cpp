@@ -0,0 +1,88 @@
+// Engine clock: readings never step backwards and trail steady_clock by
+// about its resolution; frozen time moves only when advanced, and the engine
+// stamps bids and decides expiry by it.
+#include "check.h"
+
+static void tracksSteadyClockMonotonically() {
+    EngineClock clock;
+    atomic<bool> backwards{ false }, stale{ false };
+    vector<thread> readers;
+    for (int t = 0; t < 3; t++)
+        readers.emplace_back([&] {
+            auto last = clock.now();
+            auto until = steady_clock::now() + milliseconds(100);
+            while (steady_clock::now() < until) {
+                auto now = clock.now();
+                if (now < last)
+                    backwards = true;
+                // Generous: the ticker may be descheduled on a loaded machine.
+                if (steady_clock::now() - now > milliseconds(50))
+                    stale = true;
+                last = now;
+            }
+        });
+    for (auto& reader : readers)
+        reader.join();
+    CHECK(!backwards);
+    CHECK(!stale);
+    CHECK(clock.now() <= steady_clock::now());
+
+    auto before = clock.now();
+    this_thread::sleep_for(milliseconds(20));
+    CHECK(clock.now() - before >= milliseconds(10));
+}
+
+static void frozenTimeMovesOnlyWhenAdvanced() {
+    EngineClock clock;
+    auto at = steady_clock::now() + hours(1);
+    clock.freeze(at);
+    this_thread::sleep_for(milliseconds(5));
+    CHECK(clock.now() == at);
+    clock.advance(nanoseconds(1500));
+    CHECK(clock.now() == at + nanoseconds(1500));
+
+    // Resuming from a frozen time ahead of real time holds it rather than
+    // stepping back.
+    clock.resume();
+    this_thread::sleep_for(milliseconds(5));
+    CHECK(clock.now() == at + nanoseconds(1500));
+    clock.freeze(steady_clock::now());
+    clock.resume();
+    CHECK(clock.now() <= steady_clock::now());
+
+    auto t = steady_clock::now();
+    CHECK(fromWallNanos(toWallNanos(t)) == t);
+}
+
+static void engineRunsOnItsClock() {
+    auto start = steady_clock::now();
+    engineClock().freeze(start);
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 2);
+
+    engineClock().advance(seconds(30));
+    CHECK(system.placeBidAs(bidder, item, Money::units(5)) == BidResult::Accepted);
+    vector<int64_t> stamps;
+    system.visitBidHistory(item, [&](const BidColumns& run) {
+        stamps.insert(stamps.end(), run.timestamps, run.timestamps + run.count);
+    });
+    CHECK(stamps.size() == 1 && !stamps.empty() && stamps[0] == toWallNanos(start + seconds(30)));
+    AuctionSummary summary{};
+    CHECK(system.getSummary(item, summary) && summary.active && summary.remainingSeconds == 90);
+
+    engineClock().advance(seconds(90));
+    CHECK(system.getSummary(item, summary) && summary.remainingSeconds == 0);
+    engineClock().advance(seconds(1));
+    CHECK(system.placeBidAs(bidder, item, Money::units(6)) == BidResult::NotActive);
+    CHECK(system.expireAuctions(engineNow()) == 1);
+    engineClock().resume();
+}
+
+int main() {
+    tracksSteadyClockMonotonically();
+    frozenTimeMovesOnlyWhenAdvanced();
+    engineRunsOnItsClock();
+    return finishChecks("clock_test");
+}
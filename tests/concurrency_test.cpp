@@ -0,0 +1,69 @@
+// Concurrent bidding: threads racing on shared auctions with tight balances
+// leave every auction led by its highest accepted bid and every user holding
+// exactly what it leads, and settlement conserves money.
+#include "check.h"
+
+static void racingBidsKeepEscrowExact() {
+    const int THREADS = 4, USERS = 8, ITEMS = 6, BIDS = 3000;
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    vector<Id> users, items;
+    for (int u = 0; u < USERS; u++)
+        users.push_back(system.registerUser("user" + to_string(u), "u@example.com", Money::units(150)));
+    for (int i = 0; i < ITEMS; i++)
+        items.push_back(system.createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(1), Money(), 10));
+
+    vector<vector<Money>> highest(THREADS, vector<Money>(ITEMS));
+    vector<thread> workers;
+    for (int t = 0; t < THREADS; t++)
+        workers.emplace_back([&, t] {
+            mt19937 rng(t);
+            for (int b = 0; b < BIDS; b++) {
+                int i = rng() % ITEMS;
+                Money amount(100 + (int64_t)(rng() % 10000)); // 1.00 to 100.99
+                if (system.placeBidAs(users[rng() % USERS], items[i], amount) == BidResult::Accepted)
+                    highest[t][i] = max(highest[t][i], amount);
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    unordered_map<Id, Money> leads;
+    for (int i = 0; i < ITEMS; i++) {
+        Money best;
+        for (int t = 0; t < THREADS; t++)
+            best = max(best, highest[t][i]);
+        AuctionSummary summary{};
+        CHECK(system.getSummary(items[i], summary));
+        CHECK(summary.price == best);
+        if (summary.leader != NO_ID)
+            leads[summary.leader] += summary.price;
+    }
+
+    // Exactly the led amounts are held: one cent more than the rest cannot
+    // be withdrawn, the rest can.
+    for (Id user : users) {
+        Money free = system.getBalance(user) - leads[user];
+        CHECK(free >= Money());
+        CHECK(!system.addBalanceAs(user, -(free + Money(1))));
+        CHECK(system.addBalanceAs(user, -free));
+        CHECK(system.addBalanceAs(user, free));
+    }
+
+    Money before = system.getBalance(seller);
+    for (Id user : users)
+        before += system.getBalance(user);
+    for (Id item : items)
+        system.endAuction(item);
+    Money after = system.getBalance(seller);
+    for (Id user : users) {
+        CHECK(system.getBalance(user) >= Money());
+        after += system.getBalance(user);
+    }
+    CHECK(before == after);
+}
+
+int main() {
+    racingBidsKeepEscrowExact();
+    return finishChecks("concurrency_test");
+}
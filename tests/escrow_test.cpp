@@ -0,0 +1,90 @@
+// Standalone checks for the escrow held by leading bids, one at a time and
+// through placeBids().
+#include "check.h"
+
+// A withdrawal may spend what is free but never what a leading bid holds.
+static void withdrawalKeepsEscrow() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+    CHECK(system.placeBidAs(bidder, item, Money::units(60)) == BidResult::Accepted);
+
+    CHECK(!system.addBalanceAs(bidder, Money::units(-41)));
+    CHECK(system.getBalance(bidder) == Money::units(100));
+    CHECK(system.addBalanceAs(bidder, Money::units(-40)));
+    CHECK(system.getBalance(bidder) == Money::units(60));
+    CHECK(!system.addBalanceAs(bidder, Money(-1)));
+
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    CHECK(system.getBalance(bidder) == Money());
+    CHECK(!system.addBalanceAs(bidder, Money(-1)));
+    CHECK(system.getBalance(seller) == Money::units(60));
+    CHECK(system.addBalanceAs(seller, Money::units(-60)));
+}
+
+// Replays one random batch on two identical systems, through placeBids() on
+// one and bid by bid in the batch's (item, timestamp) order on the other.
+// Balances are tight and proxies hold ceilings on some items, so bids are
+// refused for funds and holds move between batch members and proxies; the
+// outcomes must not differ, and settling everything must leave no hold.
+static void batchMatchesSingleBids() {
+    const int USERS = 6, ITEMS = 5, BIDS = 300;
+    AuctionSystem batched, single;
+    vector<Id> users, items;
+    for (AuctionSystem* system : { &batched, &single }) {
+        users.clear();
+        items.clear();
+        Id seller = system->registerUser("seller", "s@example.com", Money());
+        for (int u = 0; u < USERS; u++)
+            users.push_back(system->registerUser("user" + to_string(u), "u@example.com", Money::units(60 + 20 * u)));
+        for (int i = 0; i < ITEMS; i++)
+            items.push_back(system->createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(1), Money(), 10));
+        CHECK(system->placeProxyBidAs(users[0], items[0], Money::units(55)) == BidResult::Accepted);
+        CHECK(system->placeProxyBidAs(users[5], items[1], Money::units(90)) == BidResult::Accepted);
+    }
+
+    mt19937 rng(5);
+    auto base = engineNow();
+    vector<BidRequest> requests;
+    for (int i = 0; i < BIDS; i++)
+        requests.push_back({ items[rng() % ITEMS], users[rng() % USERS], Money::units(1 + (int)(rng() % 120)),
+                             base + nanoseconds(rng() % 1000) });
+    requests.push_back({ items[0], NO_ID, Money::units(5), base });
+    requests.push_back({ NO_ID, users[1], Money::units(5), base });
+
+    vector<BidResult> results = batched.placeBids(requests);
+    vector<size_t> order(requests.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (requests[a].itemId != requests[b].itemId)
+            return requests[a].itemId < requests[b].itemId;
+        return requests[a].timestamp < requests[b].timestamp;
+    });
+    int refused = 0;
+    for (size_t i : order) {
+        BidResult expected = single.placeBidAs(requests[i].userId, requests[i].itemId, requests[i].amount);
+        CHECK(results[i] == expected);
+        refused += expected == BidResult::InsufficientBalance;
+    }
+    CHECK(refused > 0);
+
+    for (Id item : items) {
+        AuctionSummary a{}, b{};
+        CHECK(batched.getSummary(item, a) && single.getSummary(item, b));
+        CHECK(a.price == b.price && a.bidCount == b.bidCount && a.leader == b.leader);
+        CHECK(batched.endAuction(item) == single.endAuction(item));
+    }
+    for (Id user : users) {
+        Money balance = batched.getBalance(user);
+        CHECK(balance == single.getBalance(user));
+        CHECK(batched.addBalanceAs(user, -balance));
+    }
+}
+
+int main() {
+    withdrawalKeepsEscrow();
+    batchMatchesSingleBids();
+    return finishChecks("escrow_test");
+}
@@ -0,0 +1,67 @@
+// Event sink: the engine reports bids and settlements as events, in order,
+// with their result codes, and writes nothing to the console.
+#include "check.h"
+
+static void eventsDescribeEachOutcome() {
+    ostringstream console;
+    streambuf* saved = cout.rdbuf(console.rdbuf());
+
+    BufferedSink sink;
+    AuctionSystem system;
+    system.setEventSink(&sink);
+    Id seller = system.registerUser("seller", "s@example.com", Money::units(100));
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 10);
+    Id unsold = system.createAuctionAs(seller, "vase", "glass", Money::units(10), Money(), 10);
+
+    CHECK(system.placeBidAs(bidder, item, Money::units(5)) == BidResult::BelowStartingPrice);
+    CHECK(system.placeBidAs(seller, item, Money::units(20)) == BidResult::OwnItem);
+    CHECK(system.placeBidAs(bidder, item, Money::units(20)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(bidder, item, Money::units(15)) == BidResult::BelowHighestBid);
+    CHECK(system.placeBidAs(bidder, item, Money::units(500)) == BidResult::InsufficientBalance);
+    CHECK(system.placeBidAs(NO_ID, item, Money::units(30)) == BidResult::NotLoggedIn);
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    CHECK(system.placeBidAs(bidder, item, Money::units(30)) == BidResult::NotActive);
+    CHECK(system.endAuction(unsold) == SettleResult::NoBids);
+    CHECK(system.endAuction(item) == SettleResult::AlreadyEnded);
+
+    cout.rdbuf(saved);
+    CHECK(console.str().empty());
+
+    vector<Event> events = sink.drain();
+    struct Expected {
+        EventType type;
+        BidResult bid;
+        SettleResult settle;
+        Id itemId;
+        Id userId;
+        Money amount;
+    };
+    const Expected expected[] = {
+        { EventType::BidRejected, BidResult::BelowStartingPrice, SettleResult::Sold, item, bidder, Money::units(5) },
+        { EventType::BidRejected, BidResult::OwnItem, SettleResult::Sold, item, seller, Money::units(20) },
+        { EventType::BidAccepted, BidResult::Accepted, SettleResult::Sold, item, bidder, Money::units(20) },
+        { EventType::BidRejected, BidResult::BelowHighestBid, SettleResult::Sold, item, bidder, Money::units(15) },
+        { EventType::BidRejected, BidResult::InsufficientBalance, SettleResult::Sold, item, bidder, Money::units(500) },
+        { EventType::BidRejected, BidResult::NotLoggedIn, SettleResult::Sold, item, NO_ID, Money::units(30) },
+        { EventType::AuctionSettled, BidResult::Accepted, SettleResult::Sold, item, bidder, Money::units(20) },
+        { EventType::BidRejected, BidResult::NotActive, SettleResult::Sold, item, bidder, Money::units(30) },
+        { EventType::AuctionSettled, BidResult::Accepted, SettleResult::NoBids, unsold, NO_ID, Money() },
+    };
+    CHECK(events.size() == size(expected)); // a repeated endAuction publishes nothing
+    for (size_t i = 0; i < min(events.size(), size(expected)); i++) {
+        const Event& e = events[i];
+        const Expected& x = expected[i];
+        CHECK(e.type == x.type && e.itemId == x.itemId && e.userId == x.userId && e.amount == x.amount);
+        if (e.type == EventType::AuctionSettled)
+            CHECK(e.settleResult == x.settle);
+        else
+            CHECK(e.bidResult == x.bid);
+    }
+    CHECK(sink.drain().empty());
+}
+
+int main() {
+    eventsDescribeEachOutcome();
+    return finishChecks("events_test");
+}
@@ -0,0 +1,87 @@
+// Expiry wheel: every deadline fires exactly once, on the first advance that
+// has passed it, across small steps, wraps of the wheel and jumps past a
+// whole revolution; the engine settles what fires and nothing else.
+#include "check.h"
+
+static void firesOnceOnTheFirstAdvancePastTheDeadline() {
+    const int64_t SLOTS = 4096;
+    auto origin = engineNow();
+    ExpiryWheel wheel;
+    // Deadlines sit half a second into their second and advances a quarter
+    // second into theirs, so nothing lands on a tick boundary.
+    auto at = [&](double secondsFromOrigin) {
+        return origin + duration_cast<steady_clock::duration>(duration<double>(secondsFromOrigin));
+    };
+
+    mt19937 rng(3);
+    unordered_map<Id, int64_t> deadline; // whole seconds from origin
+    for (Id id = 1; id <= 5000; id++) {
+        int64_t n = (int64_t)(rng() % (3 * SLOTS)) - 3;
+        deadline[id] = n;
+        wheel.schedule(id, at(n + 0.5));
+    }
+
+    vector<int64_t> steps;
+    for (int64_t t = 1; t <= 50; t++)
+        steps.push_back(t);
+    for (int64_t t = 57; t < SLOTS + 200; t += 7)
+        steps.push_back(t);
+    steps.push_back(steps.back() + SLOTS + 100); // more than a revolution at once
+    for (int64_t t = steps.back() + 1; t <= 3 * SLOTS + 10; t += 13)
+        steps.push_back(t);
+
+    unordered_map<Id, int64_t> firedAt;
+    bool lateScheduled = false;
+    for (int64_t t : steps) {
+        vector<Id> due;
+        wheel.advance(at(t + 0.25), due);
+        for (Id id : due) {
+            CHECK(!firedAt.count(id));
+            firedAt[id] = t;
+        }
+        if (!lateScheduled && t > 100) {
+            // Deadlines already behind the wheel fire on the next advance.
+            wheel.schedule(9001, at(10.5));
+            deadline[9001] = t;
+            lateScheduled = true;
+        }
+    }
+
+    CHECK(firedAt.size() == deadline.size());
+    for (const auto& entry : deadline) {
+        int64_t due = max<int64_t>(entry.second + 1, 1);
+        auto first = lower_bound(steps.begin(), steps.end(), due);
+        if (entry.first == 9001)
+            first = upper_bound(steps.begin(), steps.end(), entry.second);
+        CHECK(firedAt.count(entry.first) && firedAt[entry.first] == *first);
+    }
+}
+
+static void engineSettlesWhatExpired() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    auto start = engineNow();
+    Id soon = system.createAuctionAs(seller, "soon", "lot", Money::units(1), Money(), 1);
+    Id later = system.createAuctionAs(seller, "later", "lot", Money::units(1), Money(), 2);
+    Id closed = system.createAuctionAs(seller, "closed", "lot", Money::units(1), Money(), 3);
+    CHECK(system.placeBidAs(bidder, soon, Money::units(10)) == BidResult::Accepted);
+
+    CHECK(system.expireAuctions(start + seconds(30)) == 0);
+    CHECK(system.expireAuctions(start + seconds(90)) == 1);
+    AuctionSummary summary{};
+    CHECK(system.getSummary(soon, summary) && !summary.active && summary.leader == bidder);
+    CHECK(system.getBalance(seller) == Money::units(10));
+    CHECK(system.getSummary(later, summary) && summary.active);
+
+    CHECK(system.endAuction(closed) == SettleResult::NoBids);
+    CHECK(system.expireAuctions(start + minutes(5)) == 1); // `later`; `closed` was already ended
+    CHECK(system.getSummary(later, summary) && !summary.active);
+    CHECK(system.expireAuctions(start + minutes(10)) == 0);
+}
+
+int main() {
+    firesOnceOnTheFirstAdvancePastTheDeadline();
+    engineSettlesWhatExpired();
+    return finishChecks("expiry_test");
+}
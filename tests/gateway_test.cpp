@@ -0,0 +1,109 @@
+// Gateway input checks over a loopback connection: clients cannot choose
+// their starting balance, and amounts that are not finite, positive and in
+// range are refused before they reach the engine.
+#include "check.h"
+
+class TestClient {
+private:
+    int fd = -1;
+
+    void sendAll(const vector<char>& bytes) {
+        for (size_t sent = 0; sent < bytes.size();) {
+            ssize_t n = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return;
+            sent += n;
+        }
+    }
+
+    bool receiveAll(char* into, size_t size) {
+        for (size_t got = 0; got < size;) {
+            ssize_t n = recv(fd, into + got, size - got, 0);
+            if (n <= 0)
+                return false;
+            got += n;
+        }
+        return true;
+    }
+
+public:
+    ~TestClient() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    bool connect(uint16_t port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        return fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    // Sends one request and returns the response's status byte and body.
+    uint8_t call(Gateway::Op op, const BinaryWriter& body, vector<char>* reply = nullptr) {
+        BinaryWriter frame;
+        frame.put((uint32_t)(5 + body.buffer.size()));
+        frame.put((uint8_t)op);
+        frame.put((uint32_t)7);
+        frame.buffer.insert(frame.buffer.end(), body.buffer.begin(), body.buffer.end());
+        sendAll(frame.buffer);
+
+        uint32_t length = 0;
+        if (!receiveAll(reinterpret_cast<char*>(&length), 4) || length < 6)
+            return 0xff;
+        vector<char> response(length);
+        if (!receiveAll(response.data(), length))
+            return 0xff;
+        if (reply)
+            reply->assign(response.begin() + 6, response.end());
+        return (uint8_t)response[5];
+    }
+};
+
+static BinaryWriter amountBody(Id itemId, double amount) {
+    BinaryWriter body;
+    body.put(itemId);
+    body.put(amount);
+    return body;
+}
+
+static void amountsAreValidated() {
+    AuctionSystem system;
+    Gateway gateway(system);
+    CHECK(gateway.listen(0));
+    thread server([&] { gateway.run(); });
+
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 60);
+
+    TestClient client;
+    CHECK(client.connect(gateway.port()));
+    BinaryWriter registration;
+    registration.putString("bidder");
+    registration.putString("b@example.com");
+    CHECK(client.call(Gateway::Register, registration) == 0);
+    Id bidder = system.findUser("bidder");
+    CHECK(system.getBalance(bidder) == Money::units(1000));
+
+    BinaryWriter login;
+    login.putString("bidder");
+    CHECK(client.call(Gateway::Login, login) == 0);
+
+    const double invalid[] = { -50, 0, nan(""), HUGE_VAL, 1e300, Money::MAX_WIRE_AMOUNT * 2 };
+    for (double amount : invalid) {
+        CHECK(client.call(Gateway::Bid, amountBody(item, amount)) == (uint8_t)BidResult::InvalidAmount);
+        CHECK(client.call(Gateway::Proxy, amountBody(item, amount)) == (uint8_t)BidResult::InvalidAmount);
+    }
+    CHECK(system.getBalance(bidder) == Money::units(1000));
+    CHECK(client.call(Gateway::Bid, amountBody(item, 5)) == (uint8_t)BidResult::Accepted);
+
+    gateway.stop();
+    server.join();
+}
+
+int main() {
+    amountsAreValidated();
+    return finishChecks("gateway_test");
+}
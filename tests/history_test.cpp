@@ -0,0 +1,124 @@
+// Bid history: live auctions keep a recent window in memory and spill older
+// runs to the columnar archive; a closed auction spills everything. History
+// reads see one oldest-first sequence either way, also after recovery.
+#include "check.h"
+
+struct Flat {
+    vector<Id> users;
+    vector<Money> amounts;
+    vector<int64_t> timestamps;
+    size_t runs = 0;
+
+    void add(const BidColumns& run) {
+        runs++;
+        users.insert(users.end(), run.users, run.users + run.count);
+        amounts.insert(amounts.end(), run.amounts, run.amounts + run.count);
+        timestamps.insert(timestamps.end(), run.timestamps, run.timestamps + run.count);
+    }
+};
+
+static BidColumns columns(const vector<Id>& users, const vector<Money>& amounts, const vector<int64_t>& times) {
+    return { users.data(), amounts.data(), times.data(), users.size() };
+}
+
+// Runs of odd lengths (so the user column needs padding) for two items,
+// interleaved; each item reads back its own, in order, also after reopening,
+// and reopening at an earlier valid length drops the later runs.
+static void archiveKeepsRunsPerItem() {
+    const string path = "history_test.arc";
+    remove(path.c_str());
+    uint64_t firstTwo = 0, all = 0;
+    {
+        BidArchive archive;
+        CHECK(archive.open(path, 0));
+        for (int run = 0; run < 4; run++) {
+            for (Id item : { (Id)7, (Id)9 }) {
+                vector<Id> users;
+                vector<Money> amounts;
+                vector<int64_t> times;
+                for (int i = 0; i < 3 + run * 2; i++) {
+                    users.push_back(item * 100 + run);
+                    amounts.push_back(Money(item * 1000 + run * 10 + i));
+                    times.push_back(run * 100 + i);
+                }
+                CHECK(archive.append(item, columns(users, amounts, times), users.size() - 1)); // all but the last
+            }
+            if (run == 0)
+                firstTwo = archive.size();
+        }
+        all = archive.size();
+        archive.sync();
+    }
+    auto check = [&](const BidArchive& archive, Id item, int runs) {
+        Flat flat;
+        archive.visit(item, [&](const BidColumns& run) { flat.add(run); });
+        CHECK(flat.runs == (size_t)runs);
+        size_t k = 0;
+        for (int run = 0; run < runs; run++)
+            for (int i = 0; i < 2 + run * 2; i++, k++)
+                CHECK(k < flat.users.size() && flat.users[k] == item * 100 + run &&
+                      flat.amounts[k] == Money(item * 1000 + run * 10 + i) && flat.timestamps[k] == run * 100 + i);
+        CHECK(k == flat.users.size());
+    };
+    {
+        BidArchive archive;
+        CHECK(archive.open(path, all));
+        check(archive, 7, 4);
+        check(archive, 9, 4);
+        archive.visit(8, [&](const BidColumns&) { CHECK(false); });
+    }
+    {
+        BidArchive archive;
+        CHECK(archive.open(path, firstTwo));
+        check(archive, 7, 1);
+        check(archive, 9, 1);
+    }
+    remove(path.c_str());
+}
+
+static void historySpansWindowAndArchive() {
+    const string directory = "history_test.data";
+    ::system(("rm -rf " + directory).c_str());
+    const int BIDS = 300;
+    Id item;
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        Id seller = system.registerUser("seller", "s@example.com", Money());
+        Id a = system.registerUser("alice", "alice@example.com", Money::units(100000));
+        Id b = system.registerUser("bob", "bob@example.com", Money::units(100000));
+        item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+        for (int i = 1; i <= BIDS; i++)
+            CHECK(system.placeBidAs(i % 2 ? a : b, item, Money::units(i + 1)) == BidResult::Accepted);
+
+        Flat live;
+        CHECK(system.visitBidHistory(item, [&](const BidColumns& run) { live.add(run); }));
+CHECK(live.amounts.size() == BIDS && live.runs > 2);
+        for (int i = 0; i < BIDS; i++)
+            CHECK(live.amounts[i] == Money::units(i + 2) && live.users[i] == (i % 2 ? b : a));
+        CHECK(is_sorted(live.timestamps.begin(), live.timestamps.end()));
+
+        CHECK(system.endAuction(item) == SettleResult::Sold);
+        Flat closed;
+        size_t window = SIZE_MAX;
+        CHECK(system.visitBidHistory(item, [&](const BidColumns& run) {
+            closed.add(run);
+            window = run.count; // the last run visited is the live window
+        }));
+        CHECK(window == 0);
+        CHECK(closed.amounts == live.amounts && closed.users == live.users && closed.timestamps == live.timestamps);
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    Flat again;
+    CHECK(recovered.visitBidHistory(item, [&](const BidColumns& run) { again.add(run); }));
+    CHECK(again.amounts.size() == BIDS && again.amounts.back() == Money::units(BIDS + 1));
+    CHECK(!recovered.visitBidHistory(NO_ID, [&](const BidColumns&) {}));
+    ::system(("rm -rf " + directory).c_str());
+}
+
+int main() {
+    archiveKeepsRunsPerItem();
+    historySpansWindowAndArchive();
+    return finishChecks("history_test");
+}
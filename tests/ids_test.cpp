@@ -0,0 +1,75 @@
+// Interned ids: handles map to display names and back, stay unique under
+// concurrent allocation, and the string entry points resolve through them.
+#include "check.h"
+
+static void namesFollowAllocationOrder() {
+    IdTable table;
+    CHECK(table.size() == 0);
+    CHECK(table.generate() == 1);
+    CHECK(table.generate() == 2);
+    CHECK(table.name(1) == "ID1000");
+    CHECK(table.find("ID1001") == 2);
+    CHECK(table.find("ID1002") == NO_ID);
+    CHECK(table.find("1000") == NO_ID);
+    CHECK(table.name(NO_ID).empty());
+    CHECK(table.name(99).empty());
+
+    table.ensure(5); // as recovery does: later handles keep their names
+    CHECK(table.size() == 5);
+    CHECK(table.find("ID1004") == 5);
+    CHECK(table.generate() == 6);
+    table.ensure(3);
+    CHECK(table.size() == 6);
+
+    static_assert(sizeof(Bid) <= 24, "a Bid is two handles, an amount and a timestamp");
+}
+
+static void concurrentGenerateIsUnique() {
+    const int THREADS = 4, EACH = 5000;
+    IdTable table;
+    vector<vector<Id>> got(THREADS);
+    vector<thread> workers;
+    for (int t = 0; t < THREADS; t++)
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < EACH; i++) {
+                Id id = table.generate();
+                got[t].push_back(id);
+                table.name(id); // readers run alongside the growth
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    vector<Id> all;
+    for (const auto& ids : got)
+        all.insert(all.end(), ids.begin(), ids.end());
+    sort(all.begin(), all.end());
+    CHECK(all.size() == THREADS * EACH && all.front() == 1 && all.back() == THREADS * EACH);
+    CHECK(adjacent_find(all.begin(), all.end()) == all.end());
+    for (Id id : { (Id)1, (Id)777, (Id)(THREADS * EACH) })
+        CHECK(table.find(table.name(id)) == id);
+}
+
+// Users and items share one handle space, and the console's string ids
+// reach the same auction.
+static void stringEntryPointsResolve() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+    CHECK(item != seller);
+
+    SessionId session = system.login("bidder");
+    string name = "ID" + to_string(999 + item);
+    CHECK(system.placeBid(session, name, Money::units(5)) == BidResult::Accepted);
+    CHECK(system.placeBid(session, "ID999999", Money::units(6)) == BidResult::AuctionNotFound);
+    CHECK(system.endAuction(name) == SettleResult::Sold);
+    CHECK(system.endAuction("nonsense") == SettleResult::AuctionNotFound);
+}
+
+int main() {
+    namesFollowAllocationOrder();
+    concurrentGenerateIsUnique();
+    stringEntryPointsResolve();
+    return finishChecks("ids_test");
+}
@@ -0,0 +1,172 @@
+// Journal failure handling: a write the filesystem refuses latches the log
+// as failed, and a checkpoint recovers what it lost. Also recovery of the
+// single record a placeBids() call writes.
+#include <sys/resource.h>
+#include "check.h"
+
+static void limitFileSize(rlim_t bytes) {
+    rlimit limit{ bytes, RLIM_INFINITY };
+    setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+static void failedWritesAreReported() {
+    const string directory = "journal_test.data";
+    system(("rm -rf " + directory).c_str());
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        system.registerUser("before", "b@example.com", Money::units(10));
+        CHECK(system.sync());
+
+        struct stat info;
+        CHECK(stat((directory + "/auction.wal").c_str(), &info) == 0);
+        limitFileSize(info.st_size + 64);
+        for (int i = 0; i < 100; i++)
+            system.registerUser("during" + to_string(i), "d@example.com", Money::units(10));
+        CHECK(!system.sync());
+        CHECK(!system.maybeCheckpoint()); // the snapshot cannot be written either
+
+        limitFileSize(RLIM_INFINITY);
+        CHECK(system.maybeCheckpoint());
+        system.registerUser("after", "a@example.com", Money::units(10));
+        CHECK(system.sync());
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    CHECK(recovered.findUser("before") != NO_ID);
+    CHECK(recovered.findUser("during99") != NO_ID);
+    CHECK(recovered.findUser("after") != NO_ID);
+    system(("rm -rf " + directory).c_str());
+}
+
+// sync() and maybeCheckpoint() run unlocked against the same Journal that
+// checkpoint() rotates; every synced record must survive recovery.
+static void syncDuringCheckpoint() {
+    const string directory = "journal_test.rotate";
+    system(("rm -rf " + directory).c_str());
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        atomic<bool> done{ false };
+        thread checkpointer([&] {
+            while (!done.load())
+                CHECK(system.checkpoint());
+        });
+        for (int i = 0; i < 200; i++) {
+            system.registerUser("user" + to_string(i), "u@example.com", Money::units(10));
+            CHECK(system.sync());
+            CHECK(system.maybeCheckpoint());
+        }
+        done = true;
+        checkpointer.join();
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    CHECK(recovered.findUser("user0") != NO_ID);
+    CHECK(recovered.findUser("user199") != NO_ID);
+    system(("rm -rf " + directory).c_str());
+}
+
+// If the new log cannot be renamed into place, records must not go to the
+// temporary file that recovery never reads: the log reports them lost
+// until a later checkpoint succeeds and covers them.
+static void failedRenameIsReported() {
+    const string directory = "journal_test.rename";
+    const string wal = directory + "/auction.wal";
+    system(("rm -rf " + directory).c_str());
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        system.registerUser("before", "b@example.com", Money::units(10));
+        CHECK(system.sync());
+
+        // A non-empty directory where the log belongs makes the rename fail.
+        unlink(wal.c_str());
+        mkdir(wal.c_str(), 0755);
+        CHECK(::close(::open((wal + "/blocker").c_str(), O_WRONLY | O_CREAT, 0644)) == 0);
+        CHECK(!system.checkpoint());
+        system.registerUser("during", "d@example.com", Money::units(10));
+        CHECK(!system.sync());
+
+        ::system(("rm -rf " + wal).c_str());
+        CHECK(system.maybeCheckpoint());
+        system.registerUser("after", "a@example.com", Money::units(10));
+        CHECK(system.sync());
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    CHECK(recovered.findUser("before") != NO_ID);
+    CHECK(recovered.findUser("during") != NO_ID);
+    CHECK(recovered.findUser("after") != NO_ID);
+    system(("rm -rf " + directory).c_str());
+}
+
+static void failedCreateLeavesNoThread() {
+    limitFileSize(4);
+    {
+        Journal journal;
+        CHECK(!journal.create("journal_test.wal", 1));
+        CHECK(!journal.append(BinaryWriter()));
+    } // must not join a flusher that never started
+    limitFileSize(RLIM_INFINITY);
+    remove("journal_test.wal");
+}
+
+// A batch, with what the proxies did in answer, is one Batch record;
+// recovery replays it in order, and a batch with nothing accepted writes
+// nothing.
+static void batchIsOneRecord() {
+    const string directory = "journal_test.batch";
+    const string wal = directory + "/auction.wal";
+    system(("rm -rf " + directory).c_str());
+    AuctionSummary before{};
+    struct stat info;
+    {
+        AuctionSystem system;
+        CHECK(system.open(directory));
+        Id seller = system.registerUser("seller", "s@example.com", Money());
+        Id first = system.registerUser("first", "f@example.com", Money::units(100));
+        Id second = system.registerUser("second", "n@example.com", Money::units(100));
+        Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+        CHECK(system.placeProxyBidAs(second, item, Money::units(40)) == BidResult::Accepted);
+        CHECK(system.sync());
+        CHECK(stat(wal.c_str(), &info) == 0);
+        off_t empty = info.st_size;
+
+        auto now = engineNow();
+        CHECK(system.placeBids({ { item, first, Money::units(500), now } })[0] == BidResult::InsufficientBalance);
+        CHECK(system.sync());
+        CHECK(stat(wal.c_str(), &info) == 0 && info.st_size == empty);
+
+        vector<BidResult> results = system.placeBids({ { item, first, Money::units(20), now },
+                                                       { item, first, Money::units(50), now + nanoseconds(1) } });
+        CHECK(results == vector<BidResult>({ BidResult::Accepted, BidResult::Accepted }));
+        CHECK(system.sync());
+        CHECK(stat(wal.c_str(), &info) == 0);
+        // One frame (size and checksum) and type byte around three Bid
+        // entries (20, the proxy's 21, then 50) and the outbid proxy's
+        // withdrawal.
+        const size_t bid = 1 + 2 * sizeof(Id) + sizeof(Money) + sizeof(int64_t);
+        const size_t proxy = 1 + 2 * sizeof(Id) + sizeof(Money);
+        CHECK(info.st_size - empty == (off_t)(8 + 1 + 3 * bid + proxy));
+        CHECK(system.getSummary(item, before));
+        CHECK(before.leader == first && before.price == Money::units(50) && before.bidCount == 4);
+    }
+    AuctionSystem recovered;
+    CHECK(recovered.open(directory));
+    AuctionSummary after{};
+    CHECK(recovered.getSummary(before.itemId, after));
+    CHECK(after.leader == before.leader && after.price == before.price && after.bidCount == before.bidCount);
+    CHECK(!recovered.addBalanceAs(before.leader, Money::units(-51))); // 50 still held
+    system(("rm -rf " + directory).c_str());
+}
+
+int main() {
+    signal(SIGXFSZ, SIG_IGN);
+    failedWritesAreReported();
+    syncDuringCheckpoint();
+    failedRenameIsReported();
+    failedCreateLeavesNoThread();
+    batchIsOneRecord();
+    return finishChecks("journal_test");
+}
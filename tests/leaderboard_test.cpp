@@ -0,0 +1,64 @@
+// Leaderboard: best-first order, ties, one entry per bidder and the fixed
+// capacity.
+#include "check.h"
+
+static vector<Id> leaders(const Leaderboard<3>& board) {
+    vector<Id> out;
+    for (const Bid& bid : board)
+        out.push_back(bid.userId);
+    return out;
+}
+
+static void ordersBestFirst() {
+    auto t = engineNow();
+    Leaderboard<3> board;
+    CHECK(board.empty());
+    board.insert(Bid(1, Money::units(10), 9, t));
+    board.insert(Bid(2, Money::units(30), 9, t));
+    board.insert(Bid(3, Money::units(20), 9, t));
+    CHECK(leaders(board) == vector<Id>({ 2, 3, 1 }));
+    CHECK(board.top().amount == Money::units(30));
+    CHECK(board[2].userId == 1);
+}
+
+// Equal amounts rank by time, earlier first, whatever the insertion order.
+static void tiesGoToTheEarlierBid() {
+    auto t = engineNow();
+    Leaderboard<3> board;
+    board.insert(Bid(1, Money::units(10), 9, t + seconds(2)));
+    board.insert(Bid(2, Money::units(10), 9, t));
+    board.insert(Bid(3, Money::units(10), 9, t + seconds(1)));
+    CHECK(leaders(board) == vector<Id>({ 2, 3, 1 }));
+
+    // A full board keeps the earlier of two equal bids at the bottom.
+    board.insert(Bid(4, Money::units(10), 9, t + seconds(3)));
+    CHECK(leaders(board) == vector<Id>({ 2, 3, 1 }));
+    board.insert(Bid(5, Money::units(10), 9, t + seconds(1) + milliseconds(500)));
+    CHECK(leaders(board) == vector<Id>({ 2, 3, 5 }));
+}
+
+// A bidder's new bid replaces its old entry, and once full the weakest entry
+// is the one that goes.
+static void oneEntryPerBidderWithinCapacity() {
+    auto t = engineNow();
+    Leaderboard<3> board;
+    board.insert(Bid(1, Money::units(10), 9, t));
+    board.insert(Bid(2, Money::units(20), 9, t));
+    board.insert(Bid(1, Money::units(25), 9, t + seconds(1)));
+    CHECK(leaders(board) == vector<Id>({ 1, 2 }));
+    CHECK(board.top().amount == Money::units(25));
+
+    board.insert(Bid(3, Money::units(15), 9, t));
+    board.insert(Bid(4, Money::units(5), 9, t));
+    CHECK(leaders(board) == vector<Id>({ 1, 2, 3 }));
+    board.insert(Bid(4, Money::units(30), 9, t));
+    CHECK(leaders(board) == vector<Id>({ 4, 1, 2 }));
+    CHECK(board.size() == 3);
+}
+
+int main() {
+    ordersBestFirst();
+    tiesGoToTheEarlierBid();
+    oneEntryPerBidderWithinCapacity();
+    return finishChecks("leaderboard_test");
+}
@@ -0,0 +1,116 @@
+// Instrumentation: histogram buckets bound each latency within their stated
+// error, the engine counts every bid and settlement by result across
+// threads, and the Prometheus dump reports the same numbers.
+#include "check.h"
+
+static void bucketsBoundTheirValues() {
+    const size_t SUB = LatencyHistogram::SUB;
+    for (uint64_t v = 0; v < 2 * SUB; v++)
+        CHECK(LatencyHistogram::bucketOf(v) == v && LatencyHistogram::lowerBound(v) == v);
+
+    mt19937_64 rng(9);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t v = rng() >> (1 + rng() % 60); // the last bucket's bound is 2^64 itself
+        size_t bucket = LatencyHistogram::bucketOf(v);
+        CHECK(bucket + 1 < LatencyHistogram::BUCKETS);
+        uint64_t low = LatencyHistogram::lowerBound(bucket), high = LatencyHistogram::lowerBound(bucket + 1);
+        CHECK(low <= v && v < high);
+        if (v >= 2 * SUB)
+            CHECK((double)(high - low) / low <= 1.0 / SUB);
+    }
+
+    // Percentiles from the buckets land within the bucket error of the
+    // exact order statistics; merging adds up.
+    LatencyHistogram a, b;
+    vector<uint64_t> values;
+    for (int i = 0; i < 20000; i++) {
+        uint64_t v = 50 + (uint64_t)exponential_distribution<double>(1.0 / 20000)(rng);
+        values.push_back(v);
+        (i % 2 ? a : b).record(v);
+    }
+    a.merge(b);
+    sort(values.begin(), values.end());
+    CHECK(a.count() == values.size() && a.maximum() == values.back());
+    for (double q : { 0.5, 0.9, 0.99, 0.999 }) {
+        uint64_t exact = values[(size_t)(q * values.size())];
+        uint64_t reported = a.percentile(q);
+        CHECK(reported >= exact && reported <= exact + exact / SUB + 1);
+    }
+    double sum = accumulate(values.begin(), values.end(), 0.0);
+    CHECK(fabs(a.mean() - sum / values.size()) < 1e-6 * sum);
+}
+
+static void countsEveryResult() {
+    const int THREADS = 4, ROUNDS = 500;
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money::units(1000000));
+    vector<Id> bidders, items;
+    for (int t = 0; t < THREADS; t++) {
+        bidders.push_back(system.registerUser("bidder" + to_string(t), "b@example.com", Money::units(1000000)));
+        items.push_back(system.createAuctionAs(seller, "lamp" + to_string(t), "brass", Money::units(10), Money(), 10));
+    }
+    CHECK(system.login("seller") != NO_SESSION);
+    CHECK(system.login("nobody") == NO_SESSION);
+
+    // Each thread bids on its own auction, one bid per outcome each round,
+    // so the totals are known.
+    vector<thread> workers;
+    for (int t = 0; t < THREADS; t++)
+        workers.emplace_back([&, t] {
+            for (int r = 0; r < ROUNDS; r++) {
+                system.placeBidAs(bidders[t], items[t], Money::units(20 + r));
+                system.placeBidAs(bidders[t], items[t], Money::units(19 + r));
+                system.placeBidAs(bidders[t], items[t], Money::units(5));
+                system.placeBidAs(seller, items[t], Money::units(21 + r));
+                system.placeBidAs(bidders[t], items[t], Money::units(2000000));
+                system.placeBidAs(NO_ID, items[t], Money::units(30));
+            }
+        });
+    for (auto& worker : workers)
+        worker.join();
+    system.placeBidAs(bidders[0], NO_ID, Money::units(30));
+    CHECK(system.endAuction(items[0]) == SettleResult::Sold);
+    CHECK(system.endAuction(items[0]) == SettleResult::AlreadyEnded);
+    system.placeBidAs(bidders[0], items[0], Money::units(5000));
+    Id quiet = system.createAuctionAs(seller, "vase", "glass", Money::units(10), Money(), 10);
+    Id reserved = system.createAuctionAs(seller, "bowl", "glass", Money::units(10), Money::units(500), 10);
+    CHECK(system.placeBidAs(bidders[1], reserved, Money::units(50)) == BidResult::Accepted);
+    CHECK(system.endAuction(quiet) == SettleResult::NoBids);
+    CHECK(system.endAuction(reserved) == SettleResult::ReserveNotMet);
+
+    StatsSnapshot stats = system.stats();
+    auto bids = [&](BidResult result) { return stats.bids[(size_t)result]; };
+    auto settles = [&](SettleResult result) { return stats.settles[(size_t)result]; };
+    const uint64_t N = THREADS * ROUNDS;
+    CHECK(bids(BidResult::Accepted) == N + 1);
+    CHECK(bids(BidResult::BelowHighestBid) == N);
+    CHECK(bids(BidResult::BelowStartingPrice) == N);
+    CHECK(bids(BidResult::OwnItem) == N);
+    CHECK(bids(BidResult::InsufficientBalance) == N);
+    CHECK(bids(BidResult::NotLoggedIn) == N);
+    CHECK(bids(BidResult::AuctionNotFound) == 1);
+    CHECK(bids(BidResult::NotActive) == 1);
+    CHECK(settles(SettleResult::Sold) == 1 && settles(SettleResult::AlreadyEnded) == 1);
+    CHECK(settles(SettleResult::NoBids) == 1 && settles(SettleResult::ReserveNotMet) == 1);
+
+    CHECK(stats.latency[(size_t)TimedOp::PlaceBid].count() == 6 * N + 3);
+    CHECK(stats.latency[(size_t)TimedOp::Login].count() == 2);
+    CHECK(stats.latency[(size_t)TimedOp::CreateAuction].count() == THREADS + 2);
+    CHECK(stats.latency[(size_t)TimedOp::PlaceBids].count() == 0);
+
+    string text = system.prometheusStats();
+    auto has = [&](const string& line) { return text.find(line + "\n") != string::npos; };
+    CHECK(has("# TYPE auction_bids_total counter"));
+    CHECK(has("auction_bids_total{result=\"accepted\"} " + to_string(N + 1)));
+    CHECK(has("auction_bids_total{result=\"own_item\"} " + to_string(N)));
+    CHECK(has("auction_bids_total{result=\"below_ask\"} 0"));
+    CHECK(has("auction_settlements_total{result=\"reserve_not_met\"} 1"));
+    CHECK(has("auction_op_latency_seconds_count{op=\"place_bid\"} " + to_string(6 * N + 3)));
+    CHECK(has("auction_op_latency_seconds_count{op=\"login\"} 2"));
+}
+
+int main() {
+    bucketsBoundTheirValues();
+    countsEveryResult();
+    return finishChecks("metrics_test");
+}
@@ -0,0 +1,64 @@
+// Fixed-point money: amounts from outside are validated and rounded to the
+// nearest minor unit once, after which sums and comparisons are exact, also
+// in the engine's bid and balance checks.
+#include "check.h"
+
+static void roundsAndValidatesInput() {
+    CHECK(Money::fromDouble(19.99).minorUnits() == 1999);
+    CHECK(Money::fromDouble(0.1 + 0.2).minorUnits() == 30);
+    CHECK(Money::fromDouble(0.004).minorUnits() == 0);
+    CHECK(Money::fromDouble(0.006).minorUnits() == 1);
+    CHECK(Money::fromDouble(-2.5).minorUnits() == -250);
+    CHECK(Money::fromDouble(Money::MAX_WIRE_AMOUNT) == Money::units(1000000000000));
+    CHECK(Money::fromDouble(12.34).toDouble() == 12.34);
+
+    CHECK(Money::validInput(0.01) && Money::validInput(Money::MAX_WIRE_AMOUNT));
+    for (double bad : { 0.0, -0.01, -1e9, Money::MAX_WIRE_AMOUNT * 1.0001, HUGE_VAL, -HUGE_VAL, nan("") })
+        CHECK(!Money::validInput(bad));
+
+    // The largest accepted amount leaves room for many sums before int64 overflows.
+    Money most = Money::fromDouble(Money::MAX_WIRE_AMOUNT), sum;
+    for (int i = 0; i < 90000; i++)
+        sum += most;
+    CHECK(sum > most && sum.minorUnits() == most.minorUnits() * 90000);
+
+    ostringstream out;
+    out << Money(1250) << " " << Money::units(-3);
+    CHECK(out.str() == "12.5 -3");
+}
+
+static void arithmeticIsExact() {
+    Money sum;
+    for (int i = 0; i < 10; i++)
+        sum += Money::fromDouble(0.1);
+    CHECK(sum == Money::units(1));
+    CHECK(Money::fromDouble(0.1) + Money::fromDouble(0.2) == Money::fromDouble(0.3));
+    CHECK(Money::units(5) - Money(1) < Money::units(5) && -Money(7) == Money(-7));
+    CHECK(Money(1) > Money() && Money(1) >= Money(1) && Money(1) <= Money(1) && Money(1) != Money(2));
+}
+
+// With doubles, 0.1 + 0.2 outbid 0.3 and overdrew a balance of 0.3.
+static void engineComparesExactly() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id alice = system.registerUser("alice", "a@example.com", Money::fromDouble(0.3));
+    Id bob = system.registerUser("bob", "b@example.com", Money::units(10));
+    Id item = system.createAuctionAs(seller, "pin", "tin", Money::fromDouble(0.1), Money(), 10);
+
+    CHECK(system.placeBidAs(bob, item, Money::fromDouble(0.1)) == BidResult::BelowStartingPrice);
+    CHECK(system.placeBidAs(alice, item, Money::fromDouble(0.1 + 0.2)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(bob, item, Money::fromDouble(0.3)) == BidResult::BelowHighestBid);
+    CHECK(system.placeBidAs(bob, item, Money::fromDouble(0.31)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(alice, item, Money::fromDouble(0.31)) == BidResult::InsufficientBalance);
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    CHECK(system.getBalance(seller) == Money(31));
+    CHECK(system.getBalance(bob) == Money::units(10) - Money(31));
+    CHECK(system.getBalance(alice) == Money(30));
+}
+
+int main() {
+    roundsAndValidatesInput();
+    arithmeticIsExact();
+    engineComparesExactly();
+    return finishChecks("money_test");
+}
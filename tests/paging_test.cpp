@@ -0,0 +1,109 @@
+// Paged listings: a cursor resumes strictly after the last entry it saw,
+// whatever is inserted, moved or removed between pages.
+#include "check.h"
+
+static vector<Id> ids(const vector<LiveIndex<int>::Cursor>& page) {
+    vector<Id> out;
+    for (const auto& entry : page)
+        out.push_back(entry.second);
+    return out;
+}
+
+// Walks the whole index in pages of `size`, checking each page is in order
+// and continues from the previous one.
+static vector<Id> walk(const LiveIndex<int>& index, size_t size) {
+    vector<Id> all;
+    vector<LiveIndex<int>::Cursor> page = index.page(size);
+    while (!page.empty()) {
+        CHECK(page.size() <= size);
+        CHECK(is_sorted(page.begin(), page.end()));
+        for (const auto& entry : page)
+            all.push_back(entry.second);
+        auto last = page.back();
+        page = index.page(size, &last);
+        CHECK(page.empty() || last < page.front());
+    }
+    return all;
+}
+
+// Equal keys order by id, across the shards the ids fall in.
+static void pagesSpanShardsAndTies() {
+    LiveIndex<int> index;
+    vector<Id> expected;
+    for (Id id = 1; id <= 100; id++)
+        index.upsert(id, (int)(id % 10));
+    for (int key = 0; key < 10; key++)
+        for (Id id = 1; id <= 100; id++)
+            if ((int)(id % 10) == key)
+                expected.push_back(id);
+    CHECK(walk(index, 7) == expected);
+    CHECK(walk(index, 1000) == expected);
+}
+
+static void cursorSurvivesInsertsBetweenPages() {
+    LiveIndex<int> index;
+    for (Id id = 1; id <= 10; id++)
+        index.upsert(id, (int)id * 10); // keys 10..100
+    auto first = index.page(3);
+    CHECK(ids(first) == vector<Id>({ 1, 2, 3 }));
+
+    index.upsert(20, 5);   // before the cursor: not seen by this walk
+    index.upsert(21, 35);  // after it: next in line
+    index.upsert(22, 30);  // same key as the cursor, higher id: after it
+    index.upsert(5, 15);   // moved behind the cursor
+    index.upsert(2, 200);  // already seen, moved to the end: seen again
+    index.erase(4);
+    auto cursor = first.back();
+    auto second = index.page(4, &cursor);
+    CHECK(ids(second) == vector<Id>({ 22, 21, 6, 7 }));
+
+    cursor = second.back();
+    CHECK(ids(index.page(10, &cursor)) == vector<Id>({ 8, 9, 10, 2 }));
+
+    // A cursor for an entry that has since gone still resumes after its key.
+    LiveIndex<int>::Cursor gone{ 40, 4 };
+    CHECK(ids(index.page(2, &gone)) == vector<Id>({ 6, 7 }));
+}
+
+// The system's listings follow bids, new auctions and settlement.
+static void systemListingsFollowTheEngine() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(1000));
+    vector<Id> items;
+    for (int i = 0; i < 6; i++)
+        items.push_back(system.createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(10 + i), Money(),
+                                               60 * (6 - i)));
+
+    auto ending = system.endingSoonest(4);
+    CHECK(ending.size() == 4 && ending[0].second == items[5] && ending[3].second == items[2]);
+    auto byPrice = system.topByPrice(2);
+    CHECK(byPrice.size() == 2 && byPrice[0].second == items[5] && byPrice[1].second == items[4]);
+
+    CHECK(system.placeBidAs(bidder, items[0], Money::units(100)) == BidResult::Accepted);
+    CHECK(system.endAuction(items[3]) == SettleResult::NoBids);
+    Id late = system.createAuctionAs(seller, "late", "lot", Money::units(13), Money(), 1);
+
+    auto cursor = byPrice.back();
+    vector<Id> rest;
+    for (auto page = system.topByPrice(2, &cursor); !page.empty(); page = system.topByPrice(2, &cursor)) {
+        for (const auto& entry : page)
+            rest.push_back(entry.second);
+        cursor = page.back();
+    }
+    CHECK(rest == vector<Id>({ late, items[2], items[1] })); // items[0] moved ahead, items[3] closed
+
+    auto endCursor = ending.back();
+    vector<Id> later;
+    for (const auto& entry : system.endingSoonest(10, &endCursor))
+        later.push_back(entry.second);
+    CHECK(later == vector<Id>({ items[1], items[0] }));
+    CHECK(system.endingSoonest(1)[0].second == late);
+}
+
+int main() {
+    pagesSpanShardsAndTies();
+    cursorSurvivesInsertsBetweenPages();
+    systemListingsFollowTheEngine();
+    return finishChecks("paging_test");
+}
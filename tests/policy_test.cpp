@@ -0,0 +1,97 @@
+// Settlement under the Dutch and sealed-bid Vickrey policies.
+#include "check.h"
+
+// The winner pays the second-highest bid (or the reserve, if higher); the
+// rest of its escrow and every loser's is released.
+static void vickreyChargesSecondPrice() {
+    VickreyAuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id first = system.registerUser("first", "f@example.com", Money::units(100));
+    Id second = system.registerUser("second", "n@example.com", Money::units(100));
+    Id third = system.registerUser("third", "t@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 10);
+
+    CHECK(system.placeBidAs(second, item, Money::units(50)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(first, item, Money::units(80)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(third, item, Money::units(30)) == BidResult::Accepted);
+    CHECK(!system.addBalanceAs(first, Money::units(-21))); // 80 held while sealed
+
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    CHECK(system.getBalance(first) == Money::units(50));
+    CHECK(system.getBalance(seller) == Money::units(50));
+    CHECK(system.addBalanceAs(first, Money::units(-50)));
+    CHECK(system.addBalanceAs(second, Money::units(-100)));
+    CHECK(system.addBalanceAs(third, Money::units(-100)));
+
+    Id reserved = system.createAuctionAs(seller, "vase", "glass", Money::units(10), Money::units(60), 10);
+    Id rich = system.registerUser("rich", "r@example.com", Money::units(100));
+    Id other = system.registerUser("other", "o@example.com", Money::units(100));
+    CHECK(system.placeBidAs(rich, reserved, Money::units(80)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(other, reserved, Money::units(50)) == BidResult::Accepted);
+    CHECK(system.endAuction(reserved) == SettleResult::Sold);
+    CHECK(system.getBalance(rich) == Money::units(40));
+    CHECK(system.addBalanceAs(rich, Money::units(-40)));
+}
+
+// The first bid at or above the falling ask wins at once; nothing after it.
+static void dutchClosesOnFirstBid() {
+    DutchAuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id buyer = system.registerUser("buyer", "b@example.com", Money::units(200));
+    Id late = system.registerUser("late", "l@example.com", Money::units(200));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(100), Money::units(20), 10);
+
+    CHECK(system.placeBidAs(buyer, item, Money::units(10)) == BidResult::BelowAsk);
+    CHECK(system.placeBidAs(buyer, item, Money()) == BidResult::InvalidAmount);
+    CHECK(system.placeBidAs(buyer, item, Money::units(-5)) == BidResult::InvalidAmount);
+    CHECK(system.placeBidAs(buyer, item, Money::units(100)) == BidResult::Accepted);
+    AuctionSummary summary{};
+    CHECK(system.getSummary(item, summary));
+    CHECK(!summary.active);
+    CHECK(summary.leader == buyer);
+
+    CHECK(system.placeBidAs(late, item, Money::units(150)) == BidResult::AlreadySold);
+    CHECK(system.endAuction(item) == SettleResult::AlreadyEnded);
+    CHECK(system.getBalance(buyer) == Money::units(100));
+    CHECK(system.getBalance(seller) == Money::units(100));
+    CHECK(system.addBalanceAs(late, Money::units(-200)));
+}
+
+// With a reserve above the starting price the ask never reaches it, so the
+// closing bid does not meet the reserve and nothing is charged.
+static void dutchReserveAboveStart() {
+    DutchAuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id buyer = system.registerUser("buyer", "b@example.com", Money::units(200));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(100), Money::units(150), 10);
+
+    CHECK(system.placeBidAs(buyer, item, Money::units(120)) == BidResult::Accepted);
+    AuctionSummary summary{};
+    CHECK(system.getSummary(item, summary));
+    CHECK(!summary.active);
+    CHECK(!summary.reserveMet);
+    CHECK(system.getBalance(buyer) == Money::units(200));
+    CHECK(system.getBalance(seller) == Money());
+    CHECK(system.addBalanceAs(buyer, Money::units(-200)));
+}
+
+// With no reserve the ask decays to 0, but a bid must still be positive
+// whatever the ask is.
+static void dutchRejectsNonPositiveBids() {
+    DutchAuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id buyer = system.registerUser("buyer", "b@example.com", Money::units(200));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(100), Money(), 10);
+
+    CHECK(system.placeBidAs(buyer, item, Money()) == BidResult::InvalidAmount);
+    CHECK(system.placeBidAs(buyer, item, Money(-1)) == BidResult::InvalidAmount);
+    CHECK(system.getBalance(buyer) == Money::units(200));
+}
+
+int main() {
+    vickreyChargesSecondPrice();
+    dutchClosesOnFirstBid();
+    dutchReserveAboveStart();
+    dutchRejectsNonPositiveBids();
+    return finishChecks("policy_test");
+}
@@ -0,0 +1,63 @@
+// Price subscriptions: coalesced delivery and repeated unsubscribes.
+#include "check.h"
+
+// Drains `subscription` until it reports `price` for the item, or gives up
+// after about a second.
+static bool awaitPrice(const shared_ptr<PriceSubscription>& subscription, Id itemId, Money price) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        PriceUpdate update;
+        while (subscription->next(update))
+            if (update.itemId == itemId && update.price == price)
+                return true;
+        this_thread::sleep_for(milliseconds(1));
+    }
+    return false;
+}
+
+// Unsubscribing twice must not take the other watcher's count with it, or
+// the feed would stop publishing the item.
+static void repeatedUnsubscribeKeepsOtherWatchers() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 60);
+
+    auto leaving = system.subscribePrices();
+    auto staying = system.subscribePrices();
+    CHECK(system.watchPrice(leaving, item));
+    CHECK(system.watchPrice(staying, item));
+    CHECK(awaitPrice(staying, item, Money::units(10)));
+
+    system.unsubscribePrices(leaving);
+    system.unsubscribePrices(leaving);
+    CHECK(system.placeBidAs(bidder, item, Money::units(20)) == BidResult::Accepted);
+    CHECK(awaitPrice(staying, item, Money::units(20)));
+
+    CHECK(system.watchPrice(leaving, item)); // ignored once unsubscribed
+    CHECK(system.placeBidAs(bidder, item, Money::units(30)) == BidResult::Accepted);
+    CHECK(awaitPrice(staying, item, Money::units(30)));
+    PriceUpdate update;
+    CHECK(!leaving->next(update));
+    system.unsubscribePrices(staying);
+}
+
+// A slow reader sees the latest price, not every bid.
+static void updatesCoalesce() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(1000));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 60);
+
+    auto subscription = system.subscribePrices();
+    CHECK(system.watchPrice(subscription, item));
+    for (int amount = 11; amount <= 100; amount++)
+        CHECK(system.placeBidAs(bidder, item, Money::units(amount)) == BidResult::Accepted);
+    CHECK(awaitPrice(subscription, item, Money::units(100)));
+    system.unsubscribePrices(subscription);
+}
+
+int main() {
+    repeatedUnsubscribeKeepsOtherWatchers();
+    updatesCoalesce();
+    return finishChecks("prices_test");
+}
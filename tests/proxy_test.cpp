@@ -0,0 +1,61 @@
+// Proxy bidding: the top proxy clears one increment above the runner-up.
+#include "check.h"
+
+static Money currentPrice(const AuctionSystem& system, Id item, Id* leader = nullptr) {
+    AuctionSummary summary{};
+    system.getSummary(item, summary);
+    if (leader)
+        *leader = summary.leader;
+    return summary.price;
+}
+
+static void proxyClearsAboveRunnerUp() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id high = system.registerUser("high", "h@example.com", Money::units(100));
+    Id low = system.registerUser("low", "l@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 60);
+
+    // Alone, a proxy opens one increment above the starting price.
+    CHECK(system.placeProxyBidAs(high, item, Money::units(50)) == BidResult::Accepted);
+    Id leader = NO_ID;
+    CHECK(currentPrice(system, item, &leader) == Money::units(11));
+    CHECK(leader == high);
+
+    // The runner-up is bid to its ceiling and the top proxy answers one
+    // increment above it, not at its own ceiling.
+    CHECK(system.placeProxyBidAs(low, item, Money::units(30)) == BidResult::Accepted);
+    CHECK(currentPrice(system, item, &leader) == Money::units(31));
+    CHECK(leader == high);
+
+    // A plain bid above the top ceiling wins; the proxy cannot answer it.
+    CHECK(system.placeBidAs(low, item, Money::units(60)) == BidResult::Accepted);
+    CHECK(currentPrice(system, item, &leader) == Money::units(60));
+    CHECK(leader == low);
+
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    CHECK(system.getBalance(low) == Money::units(40));
+    CHECK(system.getBalance(high) == Money::units(100));
+    CHECK(system.addBalanceAs(high, Money::units(-100))); // nothing left in escrow
+}
+
+// An equal ceiling cannot outbid the proxy already leading at it.
+static void topProxyCappedAtCeiling() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id first = system.registerUser("first", "f@example.com", Money::units(100));
+    Id second = system.registerUser("second", "n@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 60);
+
+    CHECK(system.placeProxyBidAs(first, item, Money::units(40)) == BidResult::Accepted);
+    CHECK(system.placeProxyBidAs(second, item, Money::units(45)) == BidResult::Accepted);
+    Id leader = NO_ID;
+    CHECK(currentPrice(system, item, &leader) == Money::units(41));
+    CHECK(leader == second);
+}
+
+int main() {
+    proxyClearsAboveRunnerUp();
+    topProxyCappedAtCeiling();
+    return finishChecks("proxy_test");
+}
@@ -0,0 +1,109 @@
+// Standalone checks for recording, replay and stateChecksum().
+#include "check.h"
+
+// The newest id is a user or an auction like any other: changing it must
+// change the checksum.
+static void checksumCoversNewestId() {
+    AuctionSystem system;
+    system.registerUser("seller", "s@example.com", Money::units(100));
+    Id last = system.registerUser("last", "l@example.com", Money::units(100));
+    uint32_t before = system.stateChecksum();
+    SessionId session = system.login("last");
+    CHECK(system.addBalance(session, Money::units(5)));
+    CHECK(system.getBalance(last) == Money::units(105));
+    CHECK(system.stateChecksum() != before);
+
+    Id item = system.createAuctionAs(last, "lamp", "brass", Money::units(1), Money(), 10);
+    before = system.stateChecksum();
+    CHECK(system.placeBidAs(system.findUser("seller"), item, Money::units(2)) == BidResult::Accepted);
+    CHECK(system.stateChecksum() != before);
+}
+
+// Replays the recording at `path` into `target`; returns the id mismatches.
+static uint64_t replayFile(const char* path, AuctionSystem& target) {
+    vector<char> data;
+    CHECK(readFile(path, data) && data.size() > 8);
+    EngineClock& clock = engineClock();
+    auto base = clock.now();
+    clock.freeze(base);
+    Replayer replayer(target, base);
+    int64_t logical = 0;
+    for (size_t pos = 8; pos + 4 <= data.size();) {
+        uint32_t size;
+        memcpy(&size, data.data() + pos, 4);
+        BinaryReader in(data.data() + pos + 4, size);
+        pos += 4 + size;
+        logical = max(logical, in.get<int64_t>());
+        CapturedOp op = in.get<CapturedOp>();
+        clock.freeze(base + nanoseconds(logical));
+        CHECK(replayer.apply(op, in));
+    }
+    clock.resume();
+    return replayer.mismatches();
+}
+
+// A replayed recording ends in the state the recorded run ended in.
+static void replayReproducesState() {
+    const char* path = "replay_test.rec";
+    uint32_t recorded;
+    {
+        OpRecorder recorder;
+        CHECK(recorder.open(path));
+        AuctionSystem system;
+        system.setRecorder(&recorder);
+        for (int i = 0; i < 20; i++)
+            system.registerUser("u" + to_string(i), "u@example.com", Money::units(1000));
+        vector<Id> items;
+        for (int i = 0; i < 10; i++)
+            items.push_back(system.createAuctionAs((Id)(1 + i), "item", "desc", Money::units(1), Money::units(i), 1));
+        mt19937 rng(3);
+        for (int k = 0; k < 2000; k++)
+            system.placeBidAs((Id)(1 + rng() % 20), items[rng() % items.size()], Money((int64_t)(rng() % 100000)));
+        CHECK(system.addBalanceAs(20, Money::units(7)));
+        CHECK(!system.addBalanceAs(items.back(), Money::units(7))); // an auction, not a user
+        system.settleExpired(engineNow() + minutes(2));
+        recorded = system.stateChecksum();
+    }
+
+    AuctionSystem replayed;
+    CHECK(replayFile(path, replayed) == 0);
+    CHECK(replayed.stateChecksum() == recorded);
+    remove(path);
+}
+
+// Concurrent registrations and creations are recorded in the order their ids
+// were assigned, so replay hands out the same ids.
+static void concurrentCreatesKeepTheirIds() {
+    const char* path = "replay_test_concurrent.rec";
+    uint32_t recorded;
+    {
+        OpRecorder recorder;
+        CHECK(recorder.open(path));
+        AuctionSystem system;
+        system.setRecorder(&recorder);
+        vector<thread> workers;
+        for (int t = 0; t < 4; t++) {
+            workers.emplace_back([&, t] {
+                Id seller = system.registerUser("seller" + to_string(t), "s@example.com", Money::units(10));
+                system.registerUser("seller" + to_string((t + 1) % 4), "dup@example.com", Money::units(99));
+                for (int i = 0; i < 500; i++)
+                    system.createAuctionAs(seller, "item" + to_string(i), "desc", Money::units(1), Money(), 60);
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        recorded = system.stateChecksum();
+    }
+
+    AuctionSystem replayed;
+    CHECK(replayFile(path, replayed) == 0);
+    CHECK(replayed.stateChecksum() == recorded);
+    remove(path);
+}
+
+int main() {
+    checksumCoversNewestId();
+    replayReproducesState();
+    concurrentCreatesKeepTheirIds();
+    return finishChecks("replay_test");
+}
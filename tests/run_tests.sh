@@ -0,0 +1,21 @@
+#!/bin/sh
+# Builds every tests/*_test.cpp at -O0 and -O2 and runs each build; exits
+# non-zero if any build or check fails. Run from anywhere.
+#   tests/run_tests.sh [extra g++ flags...]
+cd "$(dirname "$0")/.." || exit 1
+out=$(mktemp -d) || exit 1
+trap 'rm -rf "$out"' EXIT
+status=0
+for source in tests/*_test.cpp; do
+    name=$(basename "$source" .cpp)
+    for level in -O0 -O2; do
+        if ! g++ -std=c++17 "$level" -pthread "$@" "$source" -o "$out/$name"; then
+            echo "$name ($level): build failed" >&2
+            status=1
+            continue
+        fi
+        printf '%s ' "$level"
+        (cd "$out" && "./$name") || status=1
+    done
+done
+exit $status
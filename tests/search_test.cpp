@@ -0,0 +1,54 @@
+// Search index: prefix queries, conjunctions and result ranking.
+#include "check.h"
+
+static void prefixSearchRanking() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(100));
+    Id lamp = system.createAuctionAs(seller, "Brass lamp", "desk light", Money::units(10), Money(), 300);
+    Id lantern = system.createAuctionAs(seller, "Lantern", "brass, storm-proof", Money::units(30), Money(), 100);
+    Id lanyard = system.createAuctionAs(seller, "Lanyard", "woven cord", Money::units(20), Money(), 200);
+    system.createAuctionAs(seller, "Oak table", "seats six", Money::units(40), Money(), 400);
+
+    CHECK(system.search("lan*", SearchRank::Price) == vector<Id>({ lantern, lanyard }));
+    CHECK(system.search("lan*", SearchRank::EndingSoonest) == vector<Id>({ lantern, lanyard }));
+    CHECK(system.search("LA*", SearchRank::EndingSoonest) == vector<Id>({ lantern, lanyard, lamp }));
+    CHECK(system.search("brass la*", SearchRank::Price) == vector<Id>({ lantern, lamp }));
+    CHECK(system.search("la*", SearchRank::Price, 1) == vector<Id>({ lantern }));
+    CHECK(system.search("lamp cord").empty());
+    CHECK(system.search("zebra*").empty());
+
+    // Ranking follows the live price, and settled auctions drop out.
+    CHECK(system.placeBidAs(bidder, lamp, Money::units(50)) == BidResult::Accepted);
+    CHECK(system.search("brass la*", SearchRank::Price) == vector<Id>({ lamp, lantern }));
+    CHECK(system.endAuction(lantern) == SettleResult::NoBids);
+    CHECK(system.search("la*", SearchRank::Price) == vector<Id>({ lamp, lanyard }));
+}
+
+// A prefix matching more than SearchIndex's expansion cap is cut off, and
+// the search says so rather than passing partial results off as complete.
+static void broadPrefixReportsTruncation() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    for (int i = 0; i < 300; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "part%03d", i);
+        system.createAuctionAs(seller, name, "spare", Money::units(1 + i), Money(), 60);
+    }
+
+    bool truncated = false;
+    vector<Id> found = system.search("part*", SearchRank::Price, 1000, &truncated);
+    CHECK(truncated);
+    CHECK(found.size() == 256);
+
+    CHECK(system.search("part1*", SearchRank::Price, 1000, &truncated).size() == 100);
+    CHECK(!truncated);
+    CHECK(system.search("spare", SearchRank::Price, 1000, &truncated).size() == 300);
+    CHECK(!truncated);
+}
+
+int main() {
+    prefixSearchRanking();
+    broadPrefixReportsTruncation();
+    return finishChecks("search_test");
+}
@@ -0,0 +1,92 @@
+// SeqLocked: readers racing one writer only ever see whole values, in the
+// order they were stored; the same holds for auction summaries under bids.
+#include "check.h"
+
+// Words that must always agree, so a torn copy shows. Wide enough that a
+// preempted writer is usually caught mid-store, even on one CPU.
+struct Stamp {
+    uint64_t words[512];
+};
+
+static Stamp stamp(uint64_t k) {
+    Stamp value;
+    for (uint64_t& word : value.words)
+        word = k;
+    return value;
+}
+
+static void readersSeeWholeValues() {
+    const int READERS = 3;
+    SeqLocked<Stamp> cell;
+    cell.store(stamp(0));
+    atomic<bool> done{ false };
+    atomic<int> started{ 0 }, torn{ 0 }, backwards{ 0 };
+
+    vector<thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            started++;
+            while (!done.load(memory_order_relaxed)) {
+                Stamp seen = cell.load();
+                for (uint64_t word : seen.words)
+                    torn += word != seen.words[0];
+                backwards += seen.words[0] < last;
+                last = seen.words[0];
+            }
+        });
+    }
+    while (started < READERS)
+        this_thread::yield();
+    uint64_t k = 0;
+    for (auto start = steady_clock::now(); steady_clock::now() - start < milliseconds(300);)
+        cell.store(stamp(++k));
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(cell.load().words[511] == k);
+}
+
+// Each accepted bid is one more than the last and comes from the other
+// bidder, so a consistent summary has price, count and leader in step.
+static void summariesStayConsistentUnderBids() {
+    const int BIDS = 2000;
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id even = system.registerUser("even", "e@example.com", Money::units(100000));
+    Id odd = system.registerUser("odd", "o@example.com", Money::units(100000));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(10), Money(), 60);
+
+    atomic<bool> done{ false };
+    atomic<int> inconsistent{ 0 };
+    thread reader([&] {
+        uint32_t lastCount = 0;
+        while (!done.load(memory_order_relaxed)) {
+            AuctionSummary summary{};
+            if (!system.getSummary(item, summary)) {
+                inconsistent++;
+                continue;
+            }
+            if (summary.bidCount > 0) {
+                inconsistent += summary.price != Money::units(10 + summary.bidCount);
+                inconsistent += summary.leader != (summary.bidCount % 2 ? odd : even);
+            }
+            inconsistent += summary.bidCount < lastCount;
+            lastCount = summary.bidCount;
+        }
+    });
+    for (int i = 1; i <= BIDS; i++)
+        CHECK(system.placeBidAs(i % 2 ? odd : even, item, Money::units(10 + i)) == BidResult::Accepted);
+    done = true;
+    reader.join();
+    CHECK(inconsistent == 0);
+}
+
+int main() {
+    readersSeeWholeValues();
+    summariesStayConsistentUnderBids();
+    return finishChecks("seqlock_test");
+}
@@ -0,0 +1,88 @@
+// Session handles: a closed session's slot is reused under a new
+// generation, and the old handle never reaches whoever holds it next.
+#include "check.h"
+
+static void staleHandleMissesReusedSlot() {
+    SessionTable table;
+    SessionId first = table.open(7);
+    CHECK(first != NO_SESSION && table.find(first) == 7);
+    CHECK(table.close(first));
+    CHECK(table.find(first) == NO_ID);
+
+    SessionId second = table.open(8);
+    CHECK((uint32_t)second == (uint32_t)first); // same slot
+    CHECK(second != first);
+    CHECK(table.find(second) == 8);
+    CHECK(table.find(first) == NO_ID);
+    CHECK(!table.close(first)); // the stale handle cannot close the new session
+    CHECK(table.find(second) == 8);
+
+    // Closing twice frees the slot once, so two opens get two slots.
+    CHECK(table.close(second));
+    CHECK(!table.close(second));
+    SessionId a = table.open(1), b = table.open(2);
+    CHECK((uint32_t)a != (uint32_t)b);
+    CHECK(table.find(a) == 1 && table.find(b) == 2);
+
+    CHECK(table.find(NO_SESSION) == NO_ID);
+    CHECK(table.find((uint64_t)1 << 32 | 1000) == NO_ID); // never opened
+    CHECK(!table.close(NO_SESSION));
+}
+
+// Threads churn through sessions while checking that every handle they hold
+// resolves to their own user and every handle they closed resolves to no one.
+static void churnNeverCrossesSessions() {
+    const int THREADS = 4, ROUNDS = 5000;
+    SessionTable table;
+    atomic<int> crossed{ 0 };
+    vector<thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+        workers.emplace_back([&, t] {
+            Id user = (Id)(100 + t);
+            vector<SessionId> closed;
+            for (int round = 0; round < ROUNDS; round++) {
+                SessionId session = table.open(user);
+                if (table.find(session) != user)
+                    crossed++;
+                if (!closed.empty() && table.find(closed[round % closed.size()]) != NO_ID)
+                    crossed++;
+                if (!table.close(session))
+                    crossed++;
+                if (closed.size() < 64)
+                    closed.push_back(session);
+                else
+                    closed[round % 64] = session;
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    CHECK(crossed == 0);
+}
+
+// Through the engine: a logged-out handle places nothing, even once the slot
+// belongs to another user.
+static void loggedOutHandleIsRefused() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id alice = system.registerUser("alice", "a@example.com", Money::units(100));
+    system.registerUser("bob", "b@example.com", Money::units(100));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+
+    SessionId old = system.login("alice");
+    CHECK(system.sessionUser(old) == alice);
+    system.logout(old);
+    SessionId bob = system.login("bob");
+    CHECK((uint32_t)bob == (uint32_t)old);
+    CHECK(system.sessionUser(old) == NO_ID);
+    CHECK(system.placeBid(old, item, Money::units(5)) == BidResult::NotLoggedIn);
+    CHECK(system.placeBid(bob, item, Money::units(5)) == BidResult::Accepted);
+    CHECK(system.login("nobody") == NO_SESSION);
+}
+
+int main() {
+    staleHandleMissesReusedSlot();
+    churnNeverCrossesSessions();
+    loggedOutHandleIsRefused();
+    return finishChecks("session_test");
+}
@@ -0,0 +1,92 @@
+// Batch settlement: settleExpired leaves the same state as settling the same
+// auctions one by one, settles each auction exactly once even while
+// endAuction races it, and conserves money.
+#include "check.h"
+
+struct Market {
+    AuctionSystem system;
+    vector<Id> users, items;
+
+    // Few sellers, so one settlement batch pays each of them many times.
+    Market() {
+        for (int u = 0; u < 24; u++)
+            users.push_back(system.registerUser("user" + to_string(u), "u@example.com", Money::units(5000)));
+        mt19937 rng(17);
+        for (int i = 0; i < 1500; i++) {
+            Money reserve = i % 10 == 0 ? Money::units(60) : Money();
+            items.push_back(system.createAuctionAs(users[i % 4], "item" + to_string(i), "lot", Money::units(1), reserve,
+                                                   1 + i % 3));
+        }
+        for (int b = 0; b < 6000; b++) {
+            Id item = items[rng() % items.size()];
+            system.placeBidAs(users[4 + rng() % 20], item, Money(200 + (int64_t)(rng() % 8000)));
+        }
+    }
+
+    Money total() const {
+        Money sum;
+        for (Id user : users)
+            sum += system.getBalance(user);
+        return sum;
+    }
+};
+
+static void batchMatchesOneByOne() {
+    Market batched, single;
+    CHECK(batched.system.stateChecksum() == single.system.stateChecksum());
+    Money before = batched.total();
+    auto start = engineNow();
+    for (int minute : { 1, 2, 3 }) {
+        auto now = start + minutes(minute) + seconds(30);
+        int a = batched.system.settleExpired(now);
+        int b = single.system.expireAuctions(now);
+        CHECK(a == 500 && a == b);
+        CHECK(batched.system.stateChecksum() == single.system.stateChecksum());
+    }
+    CHECK(batched.system.settleExpired(start + minutes(10)) == 0);
+    CHECK(batched.total() == before);
+    for (Id user : batched.users)
+        CHECK(batched.system.addBalanceAs(user, -batched.system.getBalance(user))); // nothing left in escrow
+}
+
+static void racingEndAuctionSettlesOnce() {
+    Market market;
+    BufferedSink sink;
+    market.system.setEventSink(&sink);
+    Money before = market.total();
+    auto later = engineNow() + minutes(5);
+
+    atomic<bool> go{ false };
+    vector<thread> closers;
+    for (int t = 0; t < 3; t++)
+        closers.emplace_back([&, t] {
+            while (!go.load())
+                this_thread::yield();
+            for (size_t i = t; i < market.items.size(); i += 2)
+                market.system.endAuction(market.items[i]);
+        });
+    go.store(true);
+    int batch = market.system.settleExpired(later);
+    for (auto& closer : closers)
+        closer.join();
+
+    unordered_map<Id, int> settled;
+    for (const Event& event : sink.drain())
+        if (event.type == EventType::AuctionSettled)
+            settled[event.itemId]++;
+    CHECK(settled.size() == market.items.size());
+    for (const auto& entry : settled)
+        CHECK(entry.second == 1);
+    CHECK(batch <= (int)market.items.size());
+    CHECK(market.total() == before);
+    for (Id item : market.items) {
+        AuctionSummary summary{};
+        CHECK(market.system.getSummary(item, summary) && !summary.active);
+    }
+}
+
+int main() {
+    batchMatchesOneByOne();
+    racingEndAuctionSettlesOnce();
+    return finishChecks("settle_test");
+}
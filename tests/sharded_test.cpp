@@ -0,0 +1,44 @@
+// Sharded engine: a bid posted right after its auction's Create must find
+// the auction, even when it reaches the item's shard first.
+#include "check.h"
+
+static void bidsFollowTheirCreate() {
+    const size_t ITEMS = 2000;
+    const Id SELLER = 100;
+    BufferedSink sink;
+    {
+        ShardedEngine engine(4);
+        engine.setEventSink(&sink);
+        engine.openAccount(0, SELLER, Money());
+        for (Id user = 1; user <= 8; user++)
+            engine.openAccount(0, user, Money::units(1000000));
+        engine.quiesce();
+
+        // Bids go via the bidder's home shard and Creates straight to the
+        // item's shard, so across many items some bids race their Create.
+        for (size_t i = 0; i < ITEMS; i++) {
+            Id itemId = Id(1000 + i);
+            engine.createAuction(0, Item(itemId, "lamp", "brass", Money::units(1), Money(), SELLER, 60));
+            engine.placeBid(0, { itemId, Id(1 + i % 8), Money::units(2), engineNow() });
+        }
+        engine.placeBid(0, { Id(1000 + ITEMS), 1, Money::units(2), engineNow() }); // never created
+        engine.quiesce();
+
+        CHECK(engine.getHeld(1) == Money::units(2 * ITEMS / 8));
+    }
+
+    size_t accepted = 0, notFound = 0;
+    for (const Event& event : sink.drain()) {
+        if (event.type == EventType::BidAccepted)
+            accepted++;
+        else if (event.type == EventType::BidRejected && event.bidResult == BidResult::AuctionNotFound)
+            notFound++;
+    }
+    CHECK(accepted == ITEMS);
+    CHECK(notFound == 1);
+}
+
+int main() {
+    bidsFollowTheirCreate();
+    return finishChecks("sharded_test");
+}
@@ -0,0 +1,115 @@
+// Sweep kernels: every SIMD kernel the CPU supports agrees with the scalar
+// one, AuctionTable::collect matches a slot-by-slot walk, and the engine's
+// sweeps match its auctions.
+#include "check.h"
+
+static void kernelsMatchScalar() {
+    vector<pair<const char*, sweep::Kernel>> kernels;
+#ifdef AUCTION_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({ "avx2", sweep::avx2 });
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+        kernels.push_back({ "avx512", sweep::avx512 });
+#endif
+    if (kernels.empty())
+        printf("sweep_test: no SIMD kernel on this CPU; checking scalar only\n");
+
+    mt19937_64 rng(7);
+    for (int round = 0; round < 4000; round++) {
+        size_t count = rng() % 100; // covers the scalar tails after each 8-wide step
+        vector<int64_t> endTicks(count);
+        vector<uint8_t> active(count);
+        vector<Id> ids(count);
+        int64_t now = (int64_t)(rng() % 1000) - 500;
+        for (size_t i = 0; i < count; i++) {
+            // Around `now`, including equal, and far off in both directions.
+            endTicks[i] = rng() % 4 == 0 ? (int64_t)rng() : now + (int64_t)(rng() % 7) - 3;
+            active[i] = rng() % 3 == 0 ? 0 : (uint8_t)(1 + rng() % 255);
+            ids[i] = (Id)(1 + i);
+        }
+        bool expired = rng() & 1;
+
+        vector<Id> expected(count + 1), actual(count + 1);
+        size_t found = sweep::scalar(endTicks.data(), active.data(), ids.data(), count, now, expired, expected.data());
+        for (size_t i = 0; i < count; i++) {
+            bool match = active[i] != 0 && (endTicks[i] < now) == expired;
+            CHECK(match == (find(expected.begin(), expected.begin() + found, ids[i]) != expected.begin() + found));
+        }
+        for (const auto& kernel : kernels) {
+            size_t got = kernel.second(endTicks.data(), active.data(), ids.data(), count, now, expired, actual.data());
+            if (got != found || !equal(expected.begin(), expected.begin() + found, actual.begin())) {
+                fprintf(stderr, "%s differs from scalar in round %d\n", kernel.first, round);
+                CHECK(false);
+            }
+        }
+    }
+}
+
+// Spans more than one chunk of the active column and more than one block.
+static void collectMatchesWalk() {
+    AuctionTable table;
+    auto now = engineNow();
+    mt19937 rng(11);
+    size_t slots = AuctionTable::BLOCK + 5000;
+    for (size_t i = 0; i < slots; i++)
+        table.add((Id)(1 + i), now + seconds((int)(rng() % 200) - 100), Money(), true);
+    for (size_t i = 0; i < slots; i += 3)
+        table.deactivate((uint32_t)i);
+
+    for (bool expired : { false, true }) {
+        vector<Id> expected, actual;
+        for (uint32_t slot = 0; slot < slots; slot++)
+            if (table.activeAt(slot) && (table.endAt(slot) < AuctionTable::ticks(now)) == expired)
+                expected.push_back(table.itemAt(slot));
+        table.collect(now, expired, actual);
+        CHECK(actual == expected);
+    }
+}
+
+// The engine's sweeps agree with each auction's own state as time passes and
+// auctions close, are bid on and expire.
+static void engineSweepsMatchSummaries() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id bidder = system.registerUser("bidder", "b@example.com", Money::units(1000));
+    auto start = engineNow();
+    vector<Id> items;
+    for (int i = 0; i < 60; i++)
+        items.push_back(system.createAuctionAs(seller, "item" + to_string(i), "lot", Money::units(1), Money(), 1 + i % 5));
+    for (int i = 0; i < 60; i += 4)
+        CHECK(system.placeBidAs(bidder, items[i], Money::units(2)) == BidResult::Accepted);
+    for (int i = 1; i < 60; i += 7)
+        system.endAuction(items[i]);
+
+    for (int minute = 0; minute <= 6; minute++) {
+        auto now = start + minutes(minute) + seconds(30);
+        if (minute == 3)
+            system.expireAuctions(now - minutes(1)); // settles what ended by 2:30
+        vector<Id> active = system.activeAuctions(now), expired = system.expiredAuctions(now);
+        sort(active.begin(), active.end());
+        sort(expired.begin(), expired.end());
+        for (int i = 0; i < 60; i++) {
+            AuctionSummary summary{};
+            CHECK(system.getSummary(items[i], summary));
+            bool running = summary.active && 1 + i % 5 > minute;
+            bool overdue = summary.active && 1 + i % 5 <= minute;
+            CHECK(binary_search(active.begin(), active.end(), items[i]) == running);
+            CHECK(binary_search(expired.begin(), expired.end(), items[i]) == overdue);
+        }
+    }
+
+    size_t priced = 0;
+    system.forEachActivePrice([&](Id item, Money price) {
+        AuctionSummary summary{};
+        CHECK(system.getSummary(item, summary) && summary.active && summary.price == price);
+        priced++;
+    });
+    CHECK(priced == system.activeAuctions(start).size());
+}
+
+int main() {
+    kernelsMatchScalar();
+    collectMatchesWalk();
+    engineSweepsMatchSummaries();
+    return finishChecks("sweep_test");
+}
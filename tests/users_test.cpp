@@ -0,0 +1,64 @@
+// Username index: lookups, duplicate checks and bulk registration agree
+// with the user table, also when threads race for the same names.
+#include "check.h"
+
+static void lookupsAndDuplicates() {
+    AuctionSystem system;
+    Id alice = system.registerUser("alice", "a@example.com", Money::units(5));
+    CHECK(alice != NO_ID);
+    CHECK(system.registerUser("alice", "other@example.com", Money::units(9)) == NO_ID);
+    CHECK(system.getBalance(alice) == Money::units(5)); // the duplicate changed nothing
+    CHECK(system.findUser("alice") == alice);
+    CHECK(system.findUser("Alice") == NO_ID);
+    CHECK(system.findUser("") == NO_ID);
+    CHECK(system.login("alice") != NO_SESSION);
+    CHECK(system.login("bob") == NO_SESSION);
+
+    // Duplicates inside the batch and against existing users are skipped.
+    vector<UserRegistration> batch;
+    for (int i = 0; i < 1000; i++)
+        batch.push_back({ "user" + to_string(i % 700), "u@example.com", Money::units(1) });
+    batch.push_back({ "alice", "a@example.com", Money::units(1) });
+    CHECK(system.registerUsers(batch) == 700);
+    set<Id> ids{ alice };
+    for (int i = 0; i < 700; i++) {
+        Id id = system.findUser("user" + to_string(i));
+        CHECK(id != NO_ID && system.getBalance(id) == Money::units(1));
+        ids.insert(id);
+    }
+    CHECK(ids.size() == 701);
+}
+
+// Every name is claimed by exactly one thread, and it resolves to that
+// thread's id.
+static void racingRegistrationsClaimEachNameOnce() {
+    const int THREADS = 4, NAMES = 2000;
+    AuctionSystem system;
+    vector<vector<Id>> won(THREADS, vector<Id>(NAMES, NO_ID));
+    vector<thread> workers;
+    for (int t = 0; t < THREADS; t++)
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < NAMES; i++)
+                won[t][i] = system.registerUser("name" + to_string(i), "n@example.com", Money::units(1));
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    for (int i = 0; i < NAMES; i++) {
+        int winners = 0;
+        Id winner = NO_ID;
+        for (int t = 0; t < THREADS; t++)
+            if (won[t][i] != NO_ID) {
+                winners++;
+                winner = won[t][i];
+            }
+        CHECK(winners == 1);
+        CHECK(system.findUser("name" + to_string(i)) == winner);
+    }
+}
+
+int main() {
+    lookupsAndDuplicates();
+    racingRegistrationsClaimEachNameOnce();
+    return finishChecks("users_test");
+}
@@ -0,0 +1,78 @@
+// In-place views: per-user maxima and the leaderboard are read under the
+// auction lock without copying, and a sealed auction shows neither until it
+// closes.
+#include "check.h"
+
+template <typename System>
+static unordered_map<Id, Money> userBids(const System& system, Id item) {
+    unordered_map<Id, Money> out;
+    CHECK(system.visitUserBids(item, [&](Id userId, Money amount) {
+        CHECK(!out.count(userId));
+        out[userId] = amount;
+    }));
+    return out;
+}
+
+template <typename System>
+static vector<Bid> leaders(const System& system, Id item) {
+    vector<Bid> out;
+    CHECK(system.visitLeaders(item, [&](const Bid& bid) { out.push_back(bid); }));
+    return out;
+}
+
+static void viewsShowHighestPerUserAndLeaders() {
+    AuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id alice = system.registerUser("alice", "a@example.com", Money::units(500));
+    Id bob = system.registerUser("bob", "b@example.com", Money::units(500));
+    Id carol = system.registerUser("carol", "c@example.com", Money::units(500));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+    Id quiet = system.createAuctionAs(seller, "vase", "glass", Money::units(1), Money(), 10);
+
+    CHECK(system.placeBidAs(alice, item, Money::units(10)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(bob, item, Money::units(20)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(alice, item, Money::units(30)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(carol, item, Money::units(25)) == BidResult::BelowHighestBid);
+    CHECK(system.placeBidAs(carol, item, Money::units(40)) == BidResult::Accepted);
+
+    unordered_map<Id, Money> highest = userBids(system, item);
+    CHECK(highest.size() == 3);
+    CHECK(highest[alice] == Money::units(30) && highest[bob] == Money::units(20) && highest[carol] == Money::units(40));
+
+    vector<Bid> top = leaders(system, item);
+    CHECK(top.size() == 3);
+    for (size_t i = 1; i < top.size(); i++)
+        CHECK(top[i - 1].amount > top[i].amount);
+    AuctionSummary summary{};
+    CHECK(system.getSummary(item, summary));
+    CHECK(!top.empty() && top[0].userId == summary.leader && top[0].amount == summary.price);
+
+    CHECK(userBids(system, quiet).empty() && leaders(system, quiet).empty());
+    CHECK(!system.visitUserBids(NO_ID, [](Id, Money) {}));
+    CHECK(!system.visitLeaders(NO_ID, [](const Bid&) {}));
+}
+
+static void sealedAuctionShowsNobodyUntilClosed() {
+    VickreyAuctionSystem system;
+    Id seller = system.registerUser("seller", "s@example.com", Money());
+    Id alice = system.registerUser("alice", "a@example.com", Money::units(500));
+    Id bob = system.registerUser("bob", "b@example.com", Money::units(500));
+    Id item = system.createAuctionAs(seller, "lamp", "brass", Money::units(1), Money(), 10);
+    CHECK(system.placeBidAs(alice, item, Money::units(50)) == BidResult::Accepted);
+    CHECK(system.placeBidAs(bob, item, Money::units(30)) == BidResult::Accepted);
+
+    CHECK(userBids(system, item).empty());
+    CHECK(leaders(system, item).empty());
+
+    CHECK(system.endAuction(item) == SettleResult::Sold);
+    unordered_map<Id, Money> highest = userBids(system, item);
+    CHECK(highest.size() == 2 && highest[alice] == Money::units(50) && highest[bob] == Money::units(30));
+    vector<Bid> top = leaders(system, item);
+    CHECK(top.size() == 2 && top[0].userId == alice && top[1].userId == bob);
+}
+
+int main() {
+    viewsShowHighestPerUserAndLeaders();
+    sealedAuctionShowsNobodyUntilClosed();
+    return finishChecks("views_test");
+}